@@ -10,42 +10,146 @@
 #ifndef EVENT_H_
 #define EVENT_H_
 
-#include <list>
+#include <vector>
 #include <functional>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 
 
 namespace nmea {
 
 
+	template<class> class EventCallable;
 	template<class> class EventHandler;
 	template<class> class Event;
 
 
+	// Type-erased callable like std::function, but callables up to InlineSize bytes
+	// (lambdas capturing a few pointers, std::function itself) are stored in place.
+	template<typename... Args>
+	class EventCallable<void(Args...)>
+	{
+	public:
+		static const size_t InlineSize = 48;
+	private:
+		struct Ops {
+			void (*invoke)(const void* storage, Args... args);
+			void (*copy)(void* to, const void* from);
+			void (*destroy)(void* storage);
+		};
+
+		template<class F>
+		struct Inline {
+			static F* get(const void* storage)		{ return const_cast<F*>(static_cast<const F*>(storage)); }
+			static void invoke(const void* storage, Args... args)	{ (*get(storage))(std::forward<Args>(args)...); }
+			static void copy(void* to, const void* from)	{ new (to) F(*get(from)); }
+			static void destroy(void* storage)		{ get(storage)->~F(); }
+			static const Ops* ops()	{ static const Ops o = { &invoke, &copy, &destroy }; return &o; }
+		};
+
+		template<class F>
+		struct Heap {
+			static F* get(const void* storage)		{ return *static_cast<F* const*>(storage); }
+			static void invoke(const void* storage, Args... args)	{ (*get(storage))(std::forward<Args>(args)...); }
+			static void copy(void* to, const void* from)	{ *static_cast<F**>(to) = new F(*get(from)); }
+			static void destroy(void* storage)		{ delete get(storage); }
+			static const Ops* ops()	{ static const Ops o = { &invoke, &copy, &destroy }; return &o; }
+		};
+
+		template<class F>
+		static constexpr bool fitsInline(){
+			return sizeof(F) <= InlineSize && alignof(F) <= alignof(std::max_align_t);
+		}
+
+		alignas(std::max_align_t) unsigned char storage[InlineSize];
+		const Ops* ops;
+
+	public:
+		EventCallable() : ops(nullptr)
+		{}
+
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, EventCallable>::value>::type>
+		EventCallable(F&& f) : ops(nullptr)	{
+			typedef typename std::decay<F>::type Callable;
+			if constexpr (fitsInline<Callable>()){
+				new (storage) Callable(std::forward<F>(f));
+				ops = Inline<Callable>::ops();
+			}
+			else{
+				*reinterpret_cast<Callable**>(storage) = new Callable(std::forward<F>(f));
+				ops = Heap<Callable>::ops();
+			}
+		}
+
+		EventCallable(const EventCallable& ref) : ops(ref.ops)	{
+			if (ops){
+				ops->copy(storage, ref.storage);
+			}
+		}
+
+		EventCallable& operator=(const EventCallable& ref)	{
+			if (&ref != this){
+				reset();
+				ops = ref.ops;
+				if (ops){
+					ops->copy(storage, ref.storage);
+				}
+			}
+			return *this;
+		}
+
+		~EventCallable()	{
+			reset();
+		}
+
+		void reset()	{
+			if (ops){
+				ops->destroy(storage);
+				ops = nullptr;
+			}
+		}
+
+		explicit operator bool() const	{
+			return ops != nullptr;
+		}
+
+		template<class... CallArgs>
+		void operator() (CallArgs&&... args) const	{
+			ops->invoke(storage, std::forward<CallArgs>(args)...);
+		}
+
+		// The stored callable if it is an F, else null
+		template<class F>
+		F* target() const	{
+			if (ops == Inline<F>::ops()){
+				return Inline<F>::get(storage);
+			}
+			if (ops == Heap<F>::ops()){
+				return Heap<F>::get(storage);
+			}
+			return nullptr;
+		}
+	};
+
 	template<typename... Args>
 	class EventHandler<void(Args...)>
 	{
 		friend Event<void(Args...)>;
 	private:
 		// Typenames
-		typename Event<void(Args...)>::ListIterator _iterator;
+		// (none)
 
 		// Static members
-		static uint64_t LastID;
+		static std::atomic<uint64_t> LastID;
 
 		// Properties
 		uint64_t ID;
-		std::function<void(Args...)> handler;
-
-		// Functions
-		void _copy(const EventHandler& ref){
-			if (&ref != this){
-				_iterator = ref._iterator;
-				handler = ref.handler;
-				ID = ref.ID;
-			}
-		}
+		EventCallable<void(Args...)> handler;
 
 	public:
 		// Typenames
@@ -58,33 +162,29 @@ namespace nmea {
 		// (none)
 
 		// Functions
-		EventHandler(std::function<void(Args...)> h) : _iterator(), handler(h), ID(++LastID)
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, EventHandler>::value>::type>
+		EventHandler(F&& h) : ID(++LastID), handler(std::forward<F>(h))
 		{}
 
-		EventHandler(const EventHandler& ref){
-			_copy(ref);
-		}
+		EventHandler(const EventHandler& ref) = default;
+		EventHandler& operator=(const EventHandler& ref) = default;
 
 		virtual ~EventHandler(){};
 
-		EventHandler& operator=(const EventHandler& ref){
-			_copy(ref);
-			return *this;
-		}
-
-		void operator() (Args... args){
-			handler(args...);
+		template<class... CallArgs>
+		void operator() (CallArgs&&... args) const {
+			handler(std::forward<CallArgs>(args)...);
 		}
 
-		bool operator==(const EventHandler& ref){
+		bool operator==(const EventHandler& ref) const {
 			return ID == ref.ID;
 		}
 
-		bool operator!=(const EventHandler& ref){
+		bool operator!=(const EventHandler& ref) const {
 			return ID != ref.ID;
 		}
 
-		uint64_t getID(){
+		uint64_t getID() const {
 			return ID;
 		}
 
@@ -92,44 +192,99 @@ namespace nmea {
 		// or null if it's not a function but implements operator()
 		CFunctionPointer* getFunctionPointer(){
 			CFunctionPointer* ptr = handler.template target<CFunctionPointer>();
+			if (ptr == nullptr){		// handlers registered through a std::function
+				std::function<void(Args...)>* f = handler.template target<std::function<void(Args...)>>();
+				if (f != nullptr){
+					ptr = f->template target<CFunctionPointer>();
+				}
+			}
 			return ptr;
 		}
 	};
 
 	template<typename... Args>
-	uint64_t EventHandler<void(Args...)>::LastID = 0;
+	std::atomic<uint64_t> EventHandler<void(Args...)>::LastID(0);
 
 
+	// Handlers are kept in a vector and called in the order they were added. Calling
+	// allocates nothing and passes the arguments through as given, references stay
+	// references. Handlers may add or remove handlers while they are being called:
+	// removed ones are not called anymore, added ones are called from the next call on.
 	template <typename ... Args>
 	class Event<void(Args...)>
 	{
-		friend EventHandler<void(Args...)>;
 	private:
 		// Typenames
-		typedef typename std::list<EventHandler<void(Args...)>>::iterator ListIterator;
+		typedef EventHandler<void(Args...)> Handler;
 
 		// Static members
 		// (none)
 
 		// Properties
-		std::list<EventHandler<void(Args...)>> handlers;
+		std::vector<Handler> handlers;		// removed handlers have ID 0 until the call in progress is over
+		std::vector<Handler> added;			// during a call
+		size_t live;
+		unsigned calling;
 
 		//Functions
 		void _copy(const Event& ref){
 			if (&ref != this){
-				handlers = ref.handlers;
+				handlers.clear();
+				for (const Handler& h : ref.handlers){
+					if (h.ID != 0){
+						handlers.push_back(h);
+					}
+				}
+				handlers.insert(handlers.end(), ref.added.begin(), ref.added.end());
+				added.clear();
+				live = handlers.size();
+				enabled = ref.enabled;
 			}
 		};
 
-		bool removeHandler(ListIterator handlerIter)	{
-			if (handlerIter == handlers.end()){
-				return false;
+		void _tidy(){
+			size_t kept = 0;
+			for (size_t i = 0; i < handlers.size(); i++){
+				if (handlers[i].ID != 0){
+					if (kept != i){
+						handlers[kept] = handlers[i];
+					}
+					kept++;
+				}
 			}
+			handlers.erase(handlers.begin() + kept, handlers.end());
+			handlers.insert(handlers.end(), added.begin(), added.end());
+			added.clear();
+		}
 
-			handlers.erase(handlerIter);
-			return true;
+		// Ends the call even when a handler throws
+		struct CallGuard {
+			Event& event;
+			CallGuard(Event& e) : event(e)	{
+				event.calling++;
+			}
+			~CallGuard()	{
+				event.calling--;
+				if (event.calling == 0 && (event.handlers.size() != event.live || !event.added.empty())){
+					event._tidy();
+				}
+			}
 		};
 
+		bool _contains(uint64_t handlerID) const {
+			for (const Handler& h : handlers){
+				if (h.ID == handlerID){
+					return true;
+				}
+			}
+			for (const Handler& h : added){
+				if (h.ID == handlerID){
+					return true;
+				}
+			}
+			return false;
+		}
+
 	public:
 		// Typenames
 		// (none)
@@ -141,73 +296,107 @@ namespace nmea {
 		bool enabled;
 
 		// Functions
-		Event() : enabled(true)
+		Event() : live(0), calling(0), enabled(true)
 		{}
 
-		virtual ~Event() 
+		virtual ~Event()
 		{}
 
-		Event(const Event& ref) 	{
+		Event(const Event& ref) : live(0), calling(0), enabled(true)	{
 			_copy(ref);
 		}
 
-		void call(Args... args)	{
-			if (!enabled) { return; }
-			for (auto h = handlers.begin(); h != handlers.end(); h++)
-			{
-				(*h)(args...);
-			}
+		Event& operator=(const Event& ref)	{
+			_copy(ref);
+			return *this;
 		}
 
-		EventHandler<void(Args...)> registerHandler(EventHandler<void(Args...)> handler)	{
-			bool found = false;
-			for (auto h = handlers.begin(); h != handlers.end(); h++)
+		template<class... CallArgs>
+		void call(CallArgs&&... args)	{
+			if (!enabled) { return; }
+			CallGuard guard(*this);
+			size_t n = handlers.size();
+			for (size_t i = 0; i < n; i++)
 			{
-				if ((*h) == handler)	{
-					found = true;
-					break;
+				if (handlers[i].ID != 0){
+					handlers[i].handler(args...);
 				}
 			}
-			if (!found)
+		}
+
+		Handler registerHandler(Handler handler)	{
+			if (!_contains(handler.ID))
 			{
-				ListIterator itr = handlers.insert(handlers.end(), handler);
-				handler._iterator = itr;
+				(calling > 0 ? added : handlers).push_back(handler);
+				live++;
 			}
 			return handler;
 		}
 
-		EventHandler<void(Args...)> registerHandler(std::function<void(Args...)> handler)	{
-			EventHandler<void(Args...)> wrapper(handler);
-			ListIterator itr = handlers.insert(handlers.end(), wrapper);
-			wrapper._iterator = itr;
-			return wrapper;
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Handler>::value>::type>
+		Handler registerHandler(F&& handler)	{
+			return registerHandler(Handler(std::forward<F>(handler)));
 		}
 
-		bool removeHandler(EventHandler<void(Args...)>& handler)	{
-			bool sts = removeHandler(handler._iterator);
-			handler._iterator = handlers.end();
-			return sts;
+		bool removeHandler(uint64_t handlerID)	{
+			if (handlerID == 0){
+				return false;
+			}
+			for (size_t i = 0; i < added.size(); i++){
+				if (added[i].ID == handlerID){
+					added.erase(added.begin() + i);
+					live--;
+					return true;
+				}
+			}
+			for (size_t i = 0; i < handlers.size(); i++){
+				if (handlers[i].ID == handlerID){
+					if (calling > 0){
+						handlers[i].ID = 0;		// the loop in call still goes over it
+					}
+					else{
+						handlers.erase(handlers.begin() + i);
+					}
+					live--;
+					return true;
+				}
+			}
+			return false;
 		};
 
-		void clear(){
-			for (auto h = handlers.begin(); h != handlers.end(); h++)
-			{
-				(*h)._iterator = handlers.end();
-			}
-			handlers.clear();
+		bool removeHandler(const Handler& handler)	{
+			return removeHandler(handler.ID);
 		};
 
-		void operator ()(Args... args)													{ return call(args...); };
-		EventHandler<void(Args...)> operator +=(EventHandler<void(Args...)> handler)	{ return registerHandler(handler); };
-		EventHandler<void(Args...)> operator +=(std::function<void(Args...)> handler)	{ return registerHandler(handler); };
-		bool operator -=(EventHandler<void(Args...)>& handler)							{ return removeHandler(handler); };
-		bool operator -=(uint64_t handlerID)											{ return removeHandler(handlerID); };
+		bool empty() const	{
+			return live == 0;
+		};
 
-		EventHandler<void(Args...)>& operator =(const EventHandler<void(Args...)>& ref){
-			_copy(ref);
-			return *this;
+		size_t size() const	{
+			return live;
+		};
+
+		void clear(){
+			added.clear();
+			if (calling > 0){
+				for (Handler& h : handlers){
+					h.ID = 0;
+				}
+			}
+			else{
+				handlers.clear();
+			}
+			live = 0;
 		};
 
+		template<class... CallArgs>
+		void operator ()(CallArgs&&... args)					{ call(std::forward<CallArgs>(args)...); };
+		Handler operator +=(Handler handler)					{ return registerHandler(handler); };
+		template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Handler>::value>::type>
+		Handler operator +=(F&& handler)						{ return registerHandler(std::forward<F>(handler)); };
+		bool operator -=(const Handler& handler)				{ return removeHandler(handler); };
+		bool operator -=(uint64_t handlerID)					{ return removeHandler(handlerID); };
+
 	};
 
 
@@ -0,0 +1,168 @@
+#ifndef INSCOLUMNS_H_
+#define INSCOLUMNS_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include <nmeaparse/INSFix.h>
+#include <nmeaparse/INSStatus.h>
+#include <nmeaparse/NMEAParser.h>
+
+namespace nmea {
+
+// Sentences of one kind decoded into arrays, one entry per sentence (row), for bulk jobs
+// and vectorized code. The columns are allocated once with the capacity, parseBatch only
+// writes into them.
+//
+// A row is valid when INSService would have read its sentence without error. Rows of
+// sentences that failed are kept, so the rows follow the sentences of the log, with NaN
+// in the values that did not parse.
+
+
+	class INSBatchParser;
+
+
+// =========================== COLUMNS =====================================
+
+	struct INSColumns {
+		friend INSBatchParser;
+
+		size_t size;					// rows filled
+		std::vector<uint64_t> valid;	// bit (row % 64) of word row / 64
+
+		explicit INSColumns(size_t capacity);
+
+		size_t capacity() const;
+		bool full() const;
+		bool isValid(size_t row) const;
+		size_t validCount() const;
+		void clear();					// size 0, the columns keep their memory
+
+	private:
+		size_t rows;
+		void setValid(size_t row, bool v);
+	};
+
+	struct AIPOVColumns : INSColumns {
+		std::vector<int64_t> time;		// ns since Jan 1, 1970 UTC, dated like INSService does
+
+		std::vector<double> heading;
+		std::vector<double> roll;
+		std::vector<double> pitch;
+
+		std::vector<double> rotation_rate_xv1;
+		std::vector<double> rotation_rate_xv2;
+		std::vector<double> rotation_rate_xv3;
+
+		std::vector<double> linear_acceleration_xv1;
+		std::vector<double> linear_acceleration_xv2;
+		std::vector<double> linear_acceleration_xv3;
+
+		std::vector<double> latitude;
+		std::vector<double> longitude;
+		std::vector<double> altitude;
+
+		std::vector<double> north_velocity;
+		std::vector<double> east_velocity;
+		std::vector<double> vertical_velocity;
+
+		std::vector<double> along_velocity_xv1;
+		std::vector<double> across_velocity_xv2;
+		std::vector<double> down_velocity_xv3;
+
+		std::vector<double> true_course;
+
+		std::vector<uint32_t> user_status;		// INSUserStatus bits
+
+		explicit AIPOVColumns(size_t capacity);
+	};
+
+	struct TECHSASColumns : INSColumns {
+		std::vector<int64_t> time;
+
+		std::vector<double> heading;
+		std::vector<double> roll;
+		std::vector<double> pitch;
+		std::vector<double> heave;
+
+		std::vector<double> roll_standard_deviation;
+		std::vector<double> pitch_standard_deviation;
+		std::vector<double> heading_standard_deviation;
+
+		std::vector<uint8_t> true_heading;		// 0/1
+		std::vector<uint8_t> x;
+		std::vector<uint8_t> y;
+
+		explicit TECHSASColumns(size_t capacity);
+	};
+
+	struct IXSEA_TAHColumns : INSColumns {
+		std::vector<int64_t> time;
+
+		std::vector<int32_t> protocol_version_id;
+		std::vector<int32_t> latency;
+
+		std::vector<INSStatus> utc_time_status;
+		std::vector<INSStatus> true_heading_status;
+		std::vector<INSStatus> roll_status;
+		std::vector<INSStatus> pitch_status;
+		std::vector<INSStatus> heave_status;
+
+		std::vector<double> true_heading;
+		std::vector<double> roll;
+		std::vector<double> pitch;
+
+		std::vector<double> heave_no_lever_arms;
+		std::vector<double> heave;
+		std::vector<double> surge;
+		std::vector<double> sway;
+
+		std::vector<double> heave_speed;
+		std::vector<double> surge_speed;
+		std::vector<double> sway_speed;
+
+		std::vector<double> heading_rate;
+
+		explicit IXSEA_TAHColumns(size_t capacity);
+	};
+
+
+// =========================== BATCH PARSER =====================================
+
+	// Decodes the lines of a buffer straight into columns. Plain sentences ('$', name,
+	// parameters, "*hh") are split and decoded in place, without NMEASentence, events or
+	// readers. Anything else (whitespace, several '$', very long lines) goes through an
+	// NMEAParser so the rows are the same as the parser would give.
+	class INSBatchParser {
+	private:
+		NMEAParser parser;
+		AIPOVColumns* aipov;			// columns of the call in progress, the others are null
+		TECHSASColumns* techsas;
+		IXSEA_TAHColumns* ixsea_tah;
+
+		template <class Columns> size_t parse(const uint8_t* data, size_t size, Columns& columns);
+		bool readPlain(const char* line, size_t size);		// false when the line needs the parser
+
+		void read_AIPOV(const std::string_view* p, size_t n, bool checksumOK);
+		void read_TECHSAS(const std::string_view* p, size_t n, bool checksumOK);
+		void read_IXSEA_TAH(const std::string_view* p, size_t n, bool checksumOK);
+		void read_ZDA(const std::string_view* p, size_t n, bool checksumOK);
+
+	public:
+		INSBatchParser();
+		virtual ~INSBatchParser();
+
+		INSDateTracker date;		// dates the rows like in INSService, from the times of all the sentences above and $GPZDA/$INZDA
+
+		// Appends a row for every sentence of the kind in the complete lines of data, and
+		// returns the bytes consumed: up to the last newline, or to the end of the line that
+		// filled the columns. Call again with the rest and more data.
+		size_t parseBatch(const uint8_t* data, size_t size, AIPOVColumns& columns);		// $AIPOV
+		size_t parseBatch(const uint8_t* data, size_t size, TECHSASColumns& columns);	// $PASHR
+		size_t parseBatch(const uint8_t* data, size_t size, IXSEA_TAHColumns& columns);	// $PHOCT
+	};
+
+}
+
+#endif /* INSCOLUMNS_H_ */
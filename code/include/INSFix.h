@@ -4,6 +4,7 @@
 #include <cstdint>
 #include <ctime>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <vector>
 #include <cmath>
@@ -11,6 +12,8 @@
 
 #include <iostream> // std::hex
 
+#include <nmeaparse/INSStatus.h>
+
 namespace nmea {
 
 	class INSTimestamp;
@@ -20,17 +23,25 @@ namespace nmea {
 
 // =========================== INS TIMESTAMP =====================================
 
+	// Days since Jan 1, 1970 of a date of the proleptic Gregorian calendar (month and day from 1).
+	// Plain arithmetic, no libc time zone state.
+	int64_t daysFromCivil(int32_t year, int32_t month, int32_t day);
+	void civilFromDays(int64_t days, int32_t& year, int32_t& month, int32_t& day);		// the other way around
+
 	// UTC time
 	class INSTimestamp {
 	private:
 		std::string monthName(uint32_t index);
 	public:
+		typedef std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds> TimePoint;
+
 		INSTimestamp();
 
 		int32_t hour;
 		int32_t min;
 		int32_t sec;
 		int32_t microsec;
+		int32_t nanosec;		// same instant as microsec, without the rounding
 
 		int32_t month;
 		int32_t day;
@@ -40,12 +51,22 @@ namespace nmea {
 		double rawTime;
 		int32_t rawDate;
 
-		time_t getTime();
+		time_t getTime() const;		// seconds since Jan 1, 1970 UTC
+		TimePoint timePoint() const;	// same, to the nanosecond
 
 		// Set directly from the NMEA time stamp
 		// hhmmss.ssssss
 		void setTime(double raw_ts);
 
+		// Same, decoded from the characters of the field, without going through a double.
+		// Returns false and changes nothing when the field is not plain "hhmmss[.s...]".
+		bool setTime(std::string_view raw_ts);
+
+		std::chrono::nanoseconds timeOfDay() const;	// since midnight UTC
+
+		int64_t days() const;			// date as days since Jan 1, 1970
+		void setDays(int64_t days);
+
 		// Set directly from the NMEA date stamp
 		// ddmmyy
 		void setDate(int32_t raw_date);
@@ -55,6 +76,43 @@ namespace nmea {
 	};
 
 
+// =========================== INS DATE TRACKER =====================================
+
+	// The iXblue sentences only carry the time of day. This follows the date from the one
+	// last set (start date or ZDA) and moves to the next day when the time of day wraps.
+	class INSDateTracker {
+	private:
+		int64_t day;			// days since Jan 1, 1970
+		std::chrono::nanoseconds last;	// latest time of day seen on that day
+		bool started;
+		uint32_t lateRun;		// sentences in a row past a forward jump
+	public:
+		INSDateTracker();
+
+		std::chrono::nanoseconds maxBackwardJump;	// larger backward jumps are a new day, 12h by default
+		// Just after midnight, times of day this close to 24:00 are late sentences from before
+		// it (1 min by default), as long as there are no more than maxLateSentences of them in a
+		// row (8 by default). A longer run is the recording going on from there. Any other
+		// forward jump is a gap in the recording, the same day.
+		std::chrono::nanoseconds maxLateness;
+		uint32_t maxLateSentences;
+
+		// One call to setDate or track
+		struct Step {
+			bool tracked;		// track, else setDate
+			int64_t day;		// date given to the time of day, or date set
+			std::chrono::nanoseconds timeOfDay;
+		};
+		std::vector<Step>* journal;		// when set, the calls are appended to it so they can be replayed on another tracker
+
+		void setDate(int32_t year, int32_t month, int32_t day);	// date of the next time of day tracked
+		void setDate(int64_t days);
+		void track(INSTimestamp& timestamp);		// gives the timestamp its date
+		int64_t track(std::chrono::nanoseconds timeOfDay);		// same, returns the date as days since Jan 1, 1970
+
+	};
+
+
 // =========================== INS FIX =====================================
 
 	class INSFix {
@@ -65,8 +123,7 @@ namespace nmea {
 
 	public:
 
-		INSFix();
-		virtual ~INSFix();
+		INSFix();		// trivially copyable, see INSService::snapshot
 
 		INSTimestamp timestamp;	// UTC time
 
@@ -98,13 +155,13 @@ namespace nmea {
 
 		double true_course;
 
-		std::string user_status;
+		INSUserStatus user_status;
 
 		std::string toString_AIPOV();
 
 	// =========================== TECHSAS =====================================
 
-		std::string T;
+		bool T;			// the fixed character is 'T', true heading
 
 		double heave;
 
@@ -121,18 +178,18 @@ namespace nmea {
 
 		int protocol_version_id;
 
-		std::string utc_time_status;
+		INSStatus utc_time_status;
 
 		int latency;
 
 		double true_heading;
 		
-		std::string true_heading_status;
-		std::string roll_status;
-		std::string pitch_status;
+		INSStatus true_heading_status;
+		INSStatus roll_status;
+		INSStatus pitch_status;
 
 		double heave_no_lever_arms;
-		std::string heave_status;
+		INSStatus heave_status;
 		
 		//double heave;
 		double surge;
@@ -0,0 +1,74 @@
+#ifndef INSHISTORY_H_
+#define INSHISTORY_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <nmeaparse/INSFix.h>
+#include <nmeaparse/SeqLock.h>
+
+namespace nmea {
+
+
+// =========================== INS POSE =====================================
+
+	struct INSPose {
+		INSTimestamp::TimePoint time;
+
+		double latitude;		// deg
+		double longitude;		// deg
+		double altitude;		// m
+
+		double heading;			// deg, [0, 360)
+		double roll;			// deg, [-180, 180)
+		double pitch;			// deg, +/-90
+	};
+
+	enum class INSInterpolation : uint8_t {
+		Linear,		// each angle on its own, the short way around
+		Slerp		// attitude as a rotation, better for large steps between samples
+	};
+
+
+// =========================== INS HISTORY =====================================
+
+	// The last poses, oldest to newest, in a fixed ring allocated by reset.
+	// One thread pushes, any number of threads query at the same time. Each slot is a
+	// seqlock holding its sequence number, so a query that meets a slot overwritten
+	// under it sees it as gone, and nothing allocates after reset.
+	class INSHistory {
+	private:
+		struct Slot {
+			uint64_t index;		// position in the sequence of pushes
+			INSPose pose;
+		};
+
+		std::unique_ptr<SeqLock<Slot>[]> slots;
+		size_t size;
+		std::chrono::nanoseconds maxAge;
+		std::atomic<uint64_t> pushed;
+		INSTimestamp::TimePoint newest;		// writer side only
+
+		bool read(uint64_t index, Slot& slot) const;		// false when the slot moved on to a later push
+	public:
+		INSHistory();
+
+		// Not safe while other threads query. A maxAge of 0 keeps all the capacity.
+		void reset(size_t capacity, std::chrono::nanoseconds maxAge = std::chrono::nanoseconds(0));
+		size_t capacity() const;
+
+		// Poses must come in time order, a pose not newer than the last one is refused.
+		bool push(const INSPose& pose);
+
+		// Pose at the given time, between the two poses around it. False when the time is
+		// not covered: before the oldest pose kept, after the newest, or older than maxAge.
+		bool query(INSTimestamp::TimePoint time, INSPose& pose, INSInterpolation interpolation = INSInterpolation::Slerp) const;
+
+		bool latest(INSPose& pose) const;
+	};
+
+}
+
+#endif /* INSHISTORY_H_ */
@@ -0,0 +1,94 @@
+#ifndef INSMULTISERVICE_H_
+#define INSMULTISERVICE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <nmeaparse/NMEAParser.h>
+#include <nmeaparse/INSService.h>
+#include <nmeaparse/RecordQueue.h>
+
+namespace nmea {
+
+// Several INS units, or a replay muxing many, behind one ingest point. The sentence
+// readers are set up once and shared by all the sources, a source only keeps its own
+// stream state (its parser) and INSService state (fix, date, history, events). All the
+// sources of a shard are parsed by the shard's worker thread, so the sources spread
+// across the cores.
+//
+// Sources are added before start. submit can then be called from any thread, but the
+// bytes of one source must come from one thread to stay in order.
+class INSMultiService {
+public:
+	static constexpr size_t ChunkSize = 1016;		// bytes carried per queue cell
+private:
+	struct Chunk {
+		uint32_t source;		// index in sources
+		uint32_t size;
+		uint8_t data[ChunkSize];
+	};
+
+	// One per source, on its own cache lines so the workers do not share any.
+	struct alignas(64) Source {
+		uint32_t id;
+		uint32_t index;		// in sources, set by start
+		size_t shard;
+		NMEAParser parser;		// with the shared sentence readers
+		INSService service;		// not attached, the shared readers read into it
+		std::atomic<uint64_t> errors;
+
+		Source(uint32_t i, NMEAParser& readers);
+	};
+
+	struct Shard {
+		MPMCQueue<Chunk> queue;
+		std::thread worker;
+
+		Shard(size_t capacity, OverflowPolicy overflow);
+	};
+
+	NMEAParser readers;		// holds the sentence readers of all the sources
+	std::vector<std::unique_ptr<Source>> sources;		// sorted by id
+	std::vector<std::unique_ptr<Shard>> shards;
+	std::atomic<bool> running;		// submit takes bytes
+	std::atomic<bool> stopping;		// no submit will push anymore, the workers drain their queue and return
+	std::atomic<uint32_t> submitting;		// submit calls in progress
+
+	Source* find(uint32_t id) const;
+	void work(Shard& shard);
+	void parse(const Chunk& chunk);
+
+public:
+	// shardCount 0 means one shard per core. The queue of each shard holds queueCapacity
+	// chunks, and overflow tells what submit does when it is full.
+	INSMultiService(size_t shardCount = 0, size_t queueCapacity = 1024, OverflowPolicy overflow = OverflowPolicy::Block);
+	virtual ~INSMultiService();
+
+	INSMultiService(const INSMultiService&) = delete;
+	INSMultiService& operator=(const INSMultiService&) = delete;
+
+	// Before start, or after stop, from the thread calling them: nullptr while running. Set
+	// up the service (events, publishTo, date) right away, its callbacks run on the worker
+	// thread of its shard.
+	INSService* addSource(uint32_t id);
+	INSService* service(uint32_t id);
+	NMEAParser* parser(uint32_t id);		// a sentence reader set on it is set for all the sources
+
+	void start();
+	void stop();		// parses what was already submitted, then joins the workers
+
+	// Copies the bytes into the queue of the source's shard. False for an unknown source,
+	// when not started, or when the DropNewest policy dropped some of the bytes.
+	bool submit(uint32_t source, const uint8_t* data, size_t size);
+
+	INSFix snapshot(uint32_t source) const;			// from any thread
+	uint64_t errorCount(uint32_t source) const;		// sentences that failed to parse
+	size_t shardCount() const;
+};
+
+}
+
+#endif /* INSMULTISERVICE_H_ */
@@ -0,0 +1,136 @@
+#ifndef INSRECORDLOG_H_
+#define INSRECORDLOG_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <nmeaparse/INSRecords.h>
+#include <nmeaparse/MappedFile.h>
+
+namespace nmea {
+
+	class INSTimeIndex;
+
+// Append-only binary log of INSRecords, read back without parsing any text.
+//
+// The file starts with a 32 byte header: "INSRLOG" and a 0, the format version, the
+// size of the header, the size of the record of each type, and a CRC of the header.
+// Blocks follow, each one a 32 byte block header (magic, CRC, payload size, record
+// count, time of its first record and latest time of its records) and its records. The CRC is the CRC-32C
+// of the block header after it and of the payload, so a block torn by a crash or
+// damaged on disk is found and skipped. Each record is its type byte and then the
+// fields of that type, packed little endian, so every type has a fixed size.
+
+
+// =========================== FORMAT =====================================
+
+	namespace INSRecordLogFormat {
+		const uint16_t Version = 1;
+		const size_t FileHeaderSize = 32;
+		const size_t BlockHeaderSize = 32;
+		const uint32_t BlockMagic = 0x4B4C4249;		// "IBLK"
+
+		// bytes of a record of that type, with its type byte, 0 for an unknown type
+		size_t recordSize(INSRecordType type);
+	}
+
+
+// =========================== WRITER =====================================
+
+	// Collects the records into blocks and writes each block with a single write.
+	// Plugs into INSService with publishTo(writer), on the parsing thread.
+	class INSRecordLogWriter {
+	private:
+		int fd;
+		bool ok;
+		std::vector<uint8_t> block;		// block header and the records not written yet
+		uint32_t count;				// records in block
+		INSTimestamp::TimePoint latest;		// of the records in block, not always the last one with late sentences
+		uint64_t records;
+		uint64_t bytes;
+
+		bool writeAll(const uint8_t* data, size_t size);
+
+	public:
+		INSRecordLogWriter();
+		virtual ~INSRecordLogWriter();		// flushes
+
+		INSRecordLogWriter(const INSRecordLogWriter&) = delete;
+		INSRecordLogWriter& operator=(const INSRecordLogWriter&) = delete;
+
+		size_t blockSize;		// payload bytes that make a block full, 64 KiB by default. Records wait in memory until then or flush.
+
+		// Creates the file, or with append adds to an existing log after its last good block.
+		// False when the file can't be written or is not a log of this version, errno tells why.
+		bool open(const std::string& path, bool append = false);
+		bool flush();		// writes the records collected so far as a block
+		bool close();
+
+		void push(const INSRecord& record);
+		bool good() const;		// false once a write failed, the records after it are lost
+
+		uint64_t recordCount() const;		// pushed since open
+		uint64_t bytesWritten() const;		// file size
+	};
+
+
+// =========================== READER =====================================
+
+	// Reads a log through a mapping, block by block. Blocks that fail their CRC are
+	// skipped and counted, the log ends at the first block that is cut off.
+	class INSRecordLogReader {
+	public:
+		// What the header of a block says
+		struct Block {
+			uint64_t offset;		// in the file
+			uint32_t size;			// payload bytes
+			uint32_t count;			// records
+			INSTimestamp::TimePoint first;		// of the first record
+			INSTimestamp::TimePoint latest;		// of all the records
+		};
+
+	private:
+		MappedFile file;
+		uint16_t fileVersion;
+		uint64_t following;		// offset of the block after the current one
+		Block current;
+		uint64_t position;		// of the next record in the file
+		uint32_t left;			// records of the current block not read yet
+		uint64_t bad;
+
+		bool readBlock(uint64_t offset, Block& block) const;		// false when there is no good block at offset
+		bool seekFrom(uint64_t offset, INSTimestamp::TimePoint time);
+
+	public:
+		INSRecordLogReader();
+		virtual ~INSRecordLogReader();
+
+		// False when the file can't be mapped, or is not a log this reader can read.
+		bool open(const std::string& path);
+		void close();
+		uint16_t version() const;
+
+		bool next(INSRecord& record);		// false at the end of the log
+		size_t read(INSRecord* records, size_t count);		// next up to count records, returns how many
+
+		// Block level access, for indexes. nextBlock moves to the next good block
+		// and returns false at the end, seekBlock jumps to a block found before.
+		bool nextBlock(Block& block);
+		bool seekBlock(uint64_t offset);
+		void rewind();
+
+		// Moves to the first record at or after time, going over the block headers from the
+		// start, or from the index entry before time. An index whose entry is not a block of
+		// this log is not used. False when no record is that late.
+		bool seek(INSTimestamp::TimePoint time);
+		bool seek(INSTimestamp::TimePoint time, const INSTimeIndex& index);
+
+		uint64_t size() const;			// of the file
+
+		uint64_t badBlocks() const;		// skipped so far
+	};
+
+}
+
+#endif /* INSRECORDLOG_H_ */
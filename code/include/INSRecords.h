@@ -0,0 +1,143 @@
+#ifndef INSRECORDS_H_
+#define INSRECORDS_H_
+
+#include <cstdint>
+#include <type_traits>
+#include <nmeaparse/INSFix.h>
+#include <nmeaparse/INSStatus.h>
+
+namespace nmea {
+
+// One record per sentence read by INSService, only the values of that sentence.
+// They are trivially copyable so they can be memcpy'd into queues and files.
+
+
+// =========================== RECORDS =====================================
+
+	struct AIPOVRecord {
+		INSTimestamp::TimePoint time;
+
+		double heading;
+		double roll;
+		double pitch;
+
+		double rotation_rate_xv1;
+		double rotation_rate_xv2;
+		double rotation_rate_xv3;
+
+		double linear_acceleration_xv1;
+		double linear_acceleration_xv2;
+		double linear_acceleration_xv3;
+
+		double latitude;
+		double longitude;
+		double altitude;
+
+		double north_velocity;
+		double east_velocity;
+		double vertical_velocity;
+
+		double along_velocity_xv1;
+		double across_velocity_xv2;
+		double down_velocity_xv3;
+
+		double true_course;
+
+		INSUserStatus user_status;
+	};
+
+	struct TECHSASRecord {
+		INSTimestamp::TimePoint time;
+
+		double heading;
+		double roll;
+		double pitch;
+		double heave;
+
+		double roll_standard_deviation;
+		double pitch_standard_deviation;
+		double heading_standard_deviation;
+
+		bool true_heading;		// the fixed character is 'T'
+		bool x;					// GPS aiding
+		bool y;					// sensor error
+	};
+
+	struct IXSEA_TAHRecord {
+		INSTimestamp::TimePoint time;
+
+		int32_t protocol_version_id;
+		int32_t latency;
+
+		INSStatus utc_time_status;
+		INSStatus true_heading_status;
+		INSStatus roll_status;
+		INSStatus pitch_status;
+		INSStatus heave_status;
+
+		double true_heading;
+		double roll;
+		double pitch;
+
+		double heave_no_lever_arms;
+		double heave;
+		double surge;
+		double sway;
+
+		double heave_speed;
+		double surge_speed;
+		double sway_speed;
+
+		double heading_rate;
+	};
+
+	struct ZDARecord {
+		INSTimestamp::TimePoint time;		// date and time of the sentence
+	};
+
+
+	// Any of the records above, for queues and files mixing the sentences
+	enum class INSRecordType : uint8_t {
+		None = 0,
+		AIPOV,
+		TECHSAS,
+		IXSEA_TAH,
+		ZDA
+	};
+
+	struct INSRecord {
+		INSRecordType type;
+		union {
+			AIPOVRecord aipov;
+			TECHSASRecord techsas;
+			IXSEA_TAHRecord ixsea_tah;
+			ZDARecord zda;
+		};
+
+		INSRecord() : type(INSRecordType::None), zda() {}
+		INSRecord(const AIPOVRecord& r) : type(INSRecordType::AIPOV), aipov(r) {}
+		INSRecord(const TECHSASRecord& r) : type(INSRecordType::TECHSAS), techsas(r) {}
+		INSRecord(const IXSEA_TAHRecord& r) : type(INSRecordType::IXSEA_TAH), ixsea_tah(r) {}
+		INSRecord(const ZDARecord& r) : type(INSRecordType::ZDA), zda(r) {}
+
+		INSTimestamp::TimePoint time() const {		// time of whichever record it holds
+			switch (type){
+			case INSRecordType::AIPOV:		return aipov.time;
+			case INSRecordType::TECHSAS:	return techsas.time;
+			case INSRecordType::IXSEA_TAH:	return ixsea_tah.time;
+			case INSRecordType::ZDA:		return zda.time;
+			default:						return INSTimestamp::TimePoint();
+			}
+		}
+	};
+
+
+	static_assert(std::is_trivially_copyable<AIPOVRecord>::value, "records are copied as bytes");
+	static_assert(std::is_trivially_copyable<TECHSASRecord>::value, "records are copied as bytes");
+	static_assert(std::is_trivially_copyable<IXSEA_TAHRecord>::value, "records are copied as bytes");
+	static_assert(std::is_trivially_copyable<ZDARecord>::value, "records are copied as bytes");
+	static_assert(std::is_trivially_copyable<INSRecord>::value, "records are copied as bytes");
+
+}
+
+#endif /* INSRECORDS_H_ */
@@ -5,8 +5,12 @@
 #include <chrono>
 #include <functional>
 #include <nmeaparse/INSFix.h>
+#include <nmeaparse/INSRecords.h>
+#include <nmeaparse/INSHistory.h>
 #include <nmeaparse/NMEAParser.h>
 #include <nmeaparse/Event.h>
+#include <nmeaparse/SeqLock.h>
+#include <nmeaparse/RecordQueue.h>
 
 namespace nmea {
 
@@ -14,18 +18,52 @@ class INSService {
 
 private:
 
-	void read_AIPOV(const NMEASentence& nmea); // $AIPOV
-	void read_TECHSAS(const NMEASentence& nmea); // $PASHR
-	void read_IXSEA_TAH(const NMEASentence& nmea); // $PHOCT
+	// Failures are reported to the parser, which throws them from readSentence/readBuffer
+	// and returns them from tryReadSentence/tryReadBuffer.
+	NMEAParseResult read_AIPOV(const NMEASentence& nmea); // $AIPOV
+	NMEAParseResult read_TECHSAS(const NMEASentence& nmea); // $PASHR
+	NMEAParseResult read_IXSEA_TAH(const NMEASentence& nmea); // $PHOCT
+	NMEAParseResult read_ZDA(const NMEASentence& nmea); // $GPZDA, $INZDA
+
+	SeqLock<INSFix> latest;		// copy of fix after every sentence read
+	std::function<void(const INSRecord&)> sink;		// see publishTo
+	NMEAParseResult publish(const NMEAParseResult& result);
+	template <class Current> static void attach(NMEAParser& parser, Current current);		// current() is the service the sentence is read into
 
 public:
 
-	INSFix fix;
+	INSFix fix;				// only for the thread feeding the parser, other threads use snapshot()
+	INSDateTracker date;		// dates the fixes, set the start date here when no ZDA is received
+	INSHistory history;			// poses of the $AIPOV read, off until history.reset(capacity) is called
+	uint64_t badZDACount;		// $GPZDA/$INZDA that could not be read, they are skipped and leave the date as it is
+
+	// Called with the values of every sentence that was read without error, after fix is updated.
+	Event<void(const AIPOVRecord&)> onAIPOV;
+	Event<void(const TECHSASRecord&)> onTECHSAS;
+	Event<void(const IXSEA_TAHRecord&)> onIXSEA_TAH;
+	Event<void(const ZDARecord&)> onZDA;
 
+	// Also pushes every record into the queue (SPSCQueue<INSRecord>, MPMCQueue<INSRecord>
+	// or anything with a push(const INSRecord&)), for consumers on other threads.
+	// The queue must outlive the service, or be replaced with publishTo(nullptr) first.
+	template <class Queue> void publishTo(Queue& queue){
+		sink = [&queue](const INSRecord& record){ queue.push(record); };
+	}
+	void publishTo(std::nullptr_t);
+
+	INSService();			// not attached to a parser, see attachToParser
 	INSService(NMEAParser& parser);
 	virtual ~INSService();
 
 	void attachToParser(NMEAParser& parser);			// will attach to this parser's nmea sentence events
+	// Same, but each sentence is read into the service current() returns at the time, so
+	// parsers sharing their sentence readers feed many services (see INSMultiService).
+	static void attachToParser(NMEAParser& parser, INSService* (*current)());
+
+	// Consistent copy of the fix as of the last sentence read, from any thread.
+	// The parser thread never waits for the readers.
+	INSFix snapshot() const;
+	uint64_t snapshotVersion() const;		// changes with every sentence read, to poll for new data
 
 };
 
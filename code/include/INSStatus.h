@@ -0,0 +1,83 @@
+#ifndef INSSTATUS_H_
+#define INSSTATUS_H_
+
+#include <cstdint>
+#include <string_view>
+
+namespace nmea {
+
+// Status fields of the iXblue sentences, decoded once when the sentence is read.
+
+
+// =========================== STATUS LETTER =====================================
+
+	// T/E/I status letters of $PHOCT
+	enum class INSStatus : uint8_t {
+		Unknown = 0,
+		Valid,			// T
+		Invalid,		// E
+		Initializing	// I
+	};
+
+	INSStatus parseINSStatus(std::string_view s);
+	char toChar(INSStatus status);		// back to the letter of the sentence, '?' for Unknown
+
+
+// =========================== USER STATUS =====================================
+
+	// The 8 hex digits of the $AIPOV user status
+	struct INSUserStatus {
+		enum Bit : uint32_t {
+			DVL_RECEIVED_VALID			= 1u << 0,
+			GPS_RECEIVED_VALID			= 1u << 1,
+			DEPTH_RECEIVED_VALID		= 1u << 2,
+			USBL_RECEIVED_VALID			= 1u << 3,
+			LBL_RECEIVED_VALID			= 1u << 4,
+			GPS2_RECEIVED_VALID			= 1u << 5,
+			EMLOG_RECEIVED_VALID		= 1u << 6,
+			MANUAL_GPS_RECEIVED_VALID	= 1u << 7,
+			TIME_RECEIVED_VALID			= 1u << 8,
+			FOG_ANOMALY					= 1u << 9,
+			ACC_ANOMALY					= 1u << 10,
+			TEMPERATURE_ERR				= 1u << 11,
+			CPU_OVERLOAD				= 1u << 12,
+			DYNAMIC_EXCEEDED			= 1u << 13,
+			SPEED_SATURATION			= 1u << 14,
+			ALTITUDE_SATURATION			= 1u << 15,
+			INPUT_A_ERR					= 1u << 16,
+			INPUT_B_ERR					= 1u << 17,
+			INPUT_C_ERR					= 1u << 18,
+			INPUT_D_ERR					= 1u << 19,
+			INPUT_E_ERR					= 1u << 20,
+			OUTPUT_A_ERR				= 1u << 21,
+			OUTPUT_B_ERR				= 1u << 22,
+			OUTPUT_C_ERR				= 1u << 23,
+			OUTPUT_D_ERR				= 1u << 24,
+			OUTPUT_E_ERR				= 1u << 25,
+			HRP_INVALID					= 1u << 26,
+			ALIGNMENT					= 1u << 27,
+			FINE_ALIGNMENT				= 1u << 28,
+			NAVIGATION					= 1u << 29,
+			DEGRADED_MODE				= 1u << 30,
+			FAILURE_MODE				= 1u << 31
+		};
+
+		uint32_t bits;
+
+		bool has(uint32_t mask) const { return (bits & mask) == mask; }		// all of the bits of mask
+		bool any(uint32_t mask) const { return (bits & mask) != 0; }
+
+		bool navigation() const		{ return has(NAVIGATION); }
+		bool aligning() const		{ return any(ALIGNMENT | FINE_ALIGNMENT); }
+		bool degraded() const		{ return has(DEGRADED_MODE); }
+		bool failure() const		{ return has(FAILURE_MODE); }
+		bool sensorAnomaly() const	{ return any(FOG_ANOMALY | ACC_ANOMALY | TEMPERATURE_ERR); }
+
+		static const char* name(Bit bit);
+	};
+
+	INSUserStatus parseINSUserStatus(std::string_view s);		// 0 when s is not hex
+
+}
+
+#endif /* INSSTATUS_H_ */
@@ -0,0 +1,77 @@
+#ifndef INSTIMEINDEX_H_
+#define INSTIMEINDEX_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <nmeaparse/INSFix.h>
+#include <nmeaparse/MappedFile.h>
+
+namespace nmea {
+
+// Sidecar index of a recorded log: INS times and the byte offsets where they are, one
+// entry per stride of time. An entry is only made where nothing before it in the log is
+// as late, so a window of a long recording can be read from the entry before it instead
+// of from the start: with LogReplay::replay(file, index, from, to, service.date) for a
+// text log, INSRecordLogReader::seek for the binary record log. A saved index is loaded
+// with the kind and size of the log it is for, so the index of another log is refused.
+class INSTimeIndex {
+public:
+	enum class Source : uint8_t {
+		None = 0,
+		Text,			// raw NMEA text, offsets of line starts
+		RecordLog		// INSRecordLog, offsets of blocks
+	};
+
+	struct Entry {
+		INSTimestamp::TimePoint time;		// first time at offset, the times before offset are all earlier
+		uint64_t offset;
+		INSTimestamp::TimePoint earliest;	// of all the times at or after offset, for a text log. Unknown (min) for a record log.
+
+		int64_t day() const;		// date of time, as days since Jan 1, 1970
+	};
+
+private:
+	std::vector<Entry> entries;		// time and offset increasing
+	std::chrono::nanoseconds interval;
+	uint64_t size;
+	Source source;
+
+	bool add(INSTimestamp::TimePoint time, uint64_t offset);
+	void setEarliest();		// from the earliest of each span between entries
+
+public:
+	INSTimeIndex();
+	virtual ~INSTimeIndex();
+
+	// One pass over the log. A text log is parsed with an INSService (the times of all
+	// the sentences it reads), dated from start until a ZDA comes.
+	void buildFromText(const MappedFile& file, std::chrono::nanoseconds stride, const INSDateTracker& start = INSDateTracker());
+	bool buildFromRecordLog(const std::string& path, std::chrono::nanoseconds stride);		// only reads the block headers
+
+	// The index file next to the log, path + ".idx"
+	static std::string sidecarPath(const std::string& path);
+	bool save(const std::string& path) const;
+	bool load(const std::string& path);		// false when missing, damaged or of another version
+	// Same, and false when the index was not made from a log of that kind and size. Nothing
+	// is changed when it fails.
+	bool load(const std::string& path, Source logSource, uint64_t logSize);
+
+	// Last entry at or before time. False when time is before the first entry, entry is then
+	// the start of the log.
+	bool find(INSTimestamp::TimePoint time, Entry& entry) const;
+	// Offset of the first entry after which all the times are later than time, late sentences
+	// included, or the end of the log. Always the end of a record log.
+	uint64_t endOffset(INSTimestamp::TimePoint time) const;
+
+	const std::vector<Entry>& getEntries() const;
+	std::chrono::nanoseconds stride() const;
+	uint64_t sourceSize() const;		// size of the log indexed, to tell a stale index
+	Source sourceType() const;
+};
+
+}
+
+#endif /* INSTIMEINDEX_H_ */
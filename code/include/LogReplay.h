@@ -0,0 +1,62 @@
+#ifndef LOGREPLAY_H_
+#define LOGREPLAY_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <nmeaparse/MappedFile.h>
+#include <nmeaparse/NMEAParser.h>
+#include <nmeaparse/Event.h>
+#include <nmeaparse/INSFix.h>
+#include <nmeaparse/INSTimeIndex.h>
+
+namespace nmea {
+
+struct LogReplayStats {
+	uint64_t bytes;			// of the file parsed so far
+	uint64_t errors;		// sentences that failed to parse
+	std::chrono::nanoseconds elapsed;
+
+	double bytesPerSecond() const;
+};
+
+// Reprocesses a recorded log (raw NMEA text, lines ending in \n or \r\n: like the parser,
+// a lone \r does not end a line) through a parser, and so through the INSService and
+// other handlers attached to it. The file is mapped and the sentences are handed to the
+// parser straight out of the mapping, nothing is copied.
+class LogReplay {
+private:
+	NMEAParser& parser;
+
+	LogReplayStats run(const uint8_t* data, size_t begin, size_t end, const MappedFile* file);
+
+public:
+	LogReplay(NMEAParser& parser);
+	virtual ~LogReplay();
+
+	bool sequentialHint;	// tells the system the file is read front to back, on by default
+	bool releaseBehind;		// drops the pages already parsed, so a multi-GB replay does not crowd the page cache. Off by default.
+	size_t step;			// bytes parsed between progress reports, 16 MiB by default
+
+	Event<void(const LogReplayStats&)> onProgress;		// after every step
+
+	// Exceptions thrown by handlers set with setSentenceHandler come through, as with readBuffer.
+	LogReplayStats replay(const MappedFile& file);
+	LogReplayStats replay(const uint8_t* data, size_t size);	// same, for bytes already in memory
+
+	// Only the bytes from begin to end, which should be line starts (see INSTimeIndex).
+	// end is clamped to the size of the file.
+	LogReplayStats replay(const MappedFile& file, uint64_t begin, uint64_t end);
+
+	// The sentences from the index entry at or before from to the index's endOffset(to),
+	// with date (the INSService's) set to the day of the entry first. All the records from
+	// from to to come out, and some before and after them. Without an entry at or before
+	// from it starts at the start of the file with date as it is. An index that is not
+	// of this text log is not used, the whole file is replayed.
+	LogReplayStats replay(const MappedFile& file, const INSTimeIndex& index, INSTimestamp::TimePoint from,
+		INSTimestamp::TimePoint to, INSDateTracker& date);
+};
+
+}
+
+#endif /* LOGREPLAY_H_ */
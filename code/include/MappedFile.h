@@ -0,0 +1,50 @@
+#ifndef MAPPEDFILE_H_
+#define MAPPEDFILE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace nmea {
+
+// A whole file mapped read only (POSIX mmap), to read recorded logs in place.
+class MappedFile {
+public:
+	// Access pattern hints, see advise
+	enum class Access : uint8_t {
+		Normal,
+		Sequential,		// read ahead more aggressively, pages behind can go early
+		Random,			// no read ahead
+		WillNeed,		// start reading the pages in now
+		DontNeed		// the pages will not be read again for a while
+	};
+
+private:
+	const uint8_t* bytes;
+	size_t length;
+
+public:
+	MappedFile();
+	virtual ~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& ref);
+	MappedFile& operator=(MappedFile&& ref);
+
+	// False when the file can't be opened or mapped, errno tells why. An empty file maps to no bytes.
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const;
+	const uint8_t* data() const;
+	size_t size() const;
+
+	// Hint for the bytes in [offset, offset + count), count 0 meaning up to the end.
+	// The range is widened to whole pages. False when the system refused it, hints are optional.
+	bool advise(Access access, size_t offset = 0, size_t count = 0) const;
+};
+
+}
+
+#endif /* MAPPEDFILE_H_ */
@@ -13,9 +13,11 @@
 
 #include <nmeaparse/Event.h>
 #include <string>
+#include <string_view>
 #include <functional>
-#include <unordered_map>
 #include <vector>
+#include <memory>
+#include <utility>
 #include <cstdint>
 #include <exception>
 
@@ -24,6 +26,11 @@
 //read class definition for info
 #define NMEA_PARSER_MAX_BUFFER_SIZE 2000
 
+//log levels below this one are compiled out of the parser (0: Info, 1: Warning, 2: Error, 3: None)
+#ifndef NMEA_PARSER_MIN_LOG_LEVEL
+#define NMEA_PARSER_MIN_LOG_LEVEL 0
+#endif
+
 
 
 
@@ -33,15 +40,20 @@ namespace nmea {
 class NMEAParser; 
 
 
+// The name, parameters and checksum are views into "text", so a sentence owns a single
+// buffer no matter how many fields it has. Copies re-point their views at their own text.
 class NMEASentence {
 	friend NMEAParser;
 private:
 	bool isvalid;
+
+	void clear();
+	void rebase(const NMEASentence& ref);		//points the views at our own text, at the same offsets as in ref
 public:
 	std::string text;			//whole plaintext of the received command
-	std::string name;			//name of the command
-	std::vector<std::string> parameters;	//list of parameters from the command
-	std::string checksum;
+	std::string_view name;			//name of the command
+	std::vector<std::string_view> parameters;	//list of parameters from the command
+	std::string_view checksum;
 	bool checksumIsCalculated;
 	uint8_t parsedChecksum;
 	uint8_t calculatedChecksum;
@@ -58,8 +70,11 @@ public:
 	};
 public:
 	NMEASentence();
+	NMEASentence(const NMEASentence& ref);
 	virtual ~NMEASentence();
 
+	NMEASentence& operator=(const NMEASentence& ref);
+
 	bool checksumOK() const;
 	bool valid() const;
 
@@ -83,38 +98,167 @@ public:
 
 
 
+enum class NMEALogLevel : uint8_t {
+	Info = 0,
+	Warning = 1,
+	Error = 2,
+	None = 3
+};
+
+
+
+
+// Outcome of the non-throwing parse functions. Errors found by the parser itself have no
+// context, errors reported by a sentence reader name it (e.g. "INS Data Bad Format [$AIPOV]").
+enum class NMEAParseStatus : uint8_t {
+	Ok = 0,
+	InvalidText,		// no '$', no name, name not alphanumeric, comma before a checksum...
+	EmptyChecksum,		// '*' at the end, without data
+	UnreadableChecksum,	// the checksum is not hex
+	InvalidCharacter,	// character not allowed in a parameter
+	ChecksumMismatch,	// the sentence reader refused a bad checksum
+	MissingParameters,	// the sentence reader needs more parameters
+	BadNumber		// a parameter is not the number the sentence reader expected
+};
+
+struct NMEAParseResult {
+	NMEAParseStatus status;
+	uint32_t offset;	// position in the sentence text where the problem was found
+	const char* context;
+
+	NMEAParseResult(NMEAParseStatus s = NMEAParseStatus::Ok, uint32_t off = 0, const char* ctx = nullptr)
+		: status(s), offset(off), context(ctx)
+	{}
+
+	bool ok() const { return status == NMEAParseStatus::Ok; }
+	explicit operator bool() const { return ok(); }
+
+	static const char* toString(NMEAParseStatus status);
+};
+
+
+
+
 class NMEAParser {
 private:
-	std::unordered_map<std::string, std::function<void(NMEASentence)>> eventTable;
-	std::string buffer;
+	// Tokenizer state. It takes one character at a time, so the byte stream can keep it
+	// up to date as the bytes arrive and the sentence is already tokenized at the newline.
+	// The byte stream's also keeps the checksum and the character checks running, a whole
+	// line is checked at once by the SIMD kernels instead.
+	struct Tokenizer {
+		std::string text;		//characters received so far, without whitespace
+		std::vector<uint32_t> commas;	//positions of the commas after the name
+		size_t dollar;			//position of the last '$', everything before it is ignored
+		size_t nameend;			//first comma after the last '$'
+		size_t firststar;
+		size_t laststar;
+		bool running;			//the fields below are kept up to date
+		size_t firstsign;		//first '+', '-' or '.'
+		size_t firstother;		//first character that is never allowed
+		uint8_t checksum;		//running XOR since the last '$'
+		uint8_t checksumatstar;		//XOR up to the last '*'
+		bool carriagereturn;		//byte stream only, a '\r' held back until we know if the newline follows
+
+		void reset();
+		void push(char c);
+		void restart();			//a new '$' was seen
+	};
+
+	// Sentence readers, sorted by key. The key packs the first 8 characters of the name,
+	// so a lookup is a binary search on integers, and the name is only compared on a match.
+	struct SentenceReader {
+		uint64_t key;
+		std::string name;
+		std::function<NMEAParseResult(const NMEASentence&)> reader;
+	};
+	std::shared_ptr<std::vector<SentenceReader>> eventTable;	//see shareSentenceReaders
+	struct DroppedSentences {
+		uint64_t key;
+		std::string name;
+		uint64_t count;
+	};
+	std::vector<DroppedSentences> dropped;		//same layout as eventTable
+	Tokenizer stream;		//sentence being received by the byte stream
+	Tokenizer line;			//used by readSentence
+	uint32_t buffered;		//raw bytes of the sentence being received by the byte stream
 	bool fillingbuffer;
 	uint32_t maxbuffersize;		//limit the max size if no newline ever comes... Prevents huge buffer string internally
+	NMEASentence sentence;		//reused for every sentence, so its buffers keep their capacity between calls
+
+	static uint64_t sentenceKey(std::string_view name);
+	const SentenceReader* findSentenceReader(std::string_view name) const;		//nullptr when nothing is registered for that name
+
+	bool dropSentence(std::string_view name);		//prefilter, true when nobody reads that sentence. The name must be framed already.
+	static bool frameName(std::string_view cmd, std::string_view& name);	//finds the name of a line the way the tokenizer would, false when it needs the full parse
 
-	void parseText	(NMEASentence& nmea, std::string s);		//fills the given NMEA sentence with the results of parsing the string.
+	NMEAParseResult parseTokens(NMEASentence& nmea, Tokenizer& tokens);		//fills the given NMEA sentence with the results of parsing the tokenized line, takes its text.
+	NMEAParseResult readTokens	(NMEASentence& nmea, Tokenizer& tokens, size_t rawsize);	//parses, checks and dispatches a tokenized line
+
+	void streamBytes	(const char* b, size_t size);
+	NMEAParseResult readStreamSentence	();
+	void resetStream	();
+	NMEAParseResult readStream	(const uint8_t* b, uint32_t size, uint32_t& consumed);
 	
-	void onInfo		(NMEASentence& n, std::string s);
-	void onWarning	(NMEASentence& n, std::string s);
-	void onError	(NMEASentence& n, std::string s);
+	// Messages are strings or callables returning one, a callable is only called when its level is logged.
+	template<class Message> void onLog	(NMEALogLevel level, NMEASentence& n, const Message& message);
+	template<class Message> void onInfo		(NMEASentence& n, const Message& message);
+	template<class Message> void onWarning	(NMEASentence& n, const Message& message);
+	void writeLog	(NMEALogLevel level, NMEASentence& n, std::string_view message);
+	std::string errorMessage	(const NMEAParseResult& result);	// describes a failure of the current sentence
+	void onError	(const NMEAParseResult& result);		// throws the NMEAParseError describing the result
 public:
 
 	NMEAParser();
 	virtual ~NMEAParser();
 
-	bool log;
+	bool log;					// logging switch, off by default
+	NMEALogLevel logLevel;		// lowest level logged when log is on
+	std::function<void(NMEALogLevel, std::string_view, const NMEASentence&)> logSink;	// receives the log, std::cout when empty
+
+	bool logging(NMEALogLevel level) const {
+#if NMEA_PARSER_MIN_LOG_LEVEL > 0
+		if ((int)level < NMEA_PARSER_MIN_LOG_LEVEL){
+			return false;
+		}
+#endif
+		return log && level >= logLevel;
+	}
 
 	Event<void(const NMEASentence&)> onSentence;				// called every time parser receives any NMEA sentence
 	void setSentenceHandler(std::string cmdKey, std::function<void(const NMEASentence&)> handler);	//one handler called for any named sentence where name is the "cmdKey"
+	void setSentenceReader(std::string cmdKey, std::function<NMEAParseResult(const NMEASentence&)> reader);	//same, for handlers that report their failures instead of throwing
 	std::string getRegisteredSentenceHandlersCSV();                          // show a list of message names that currently have handlers.
+	// Uses the sentence readers of parser from now on, one table for both: a reader set on
+	// either is set on the other. For many streams read the same way (see INSMultiService),
+	// each parser keeping its own stream state.
+	void shareSentenceReaders(NMEAParser& parser);
+
+	// When prefilter is on, sentences that neither onSentence nor a sentence reader will see are
+	// dropped as soon as their name is framed, without the full parse and its error reports.
+	bool prefilter;
+	uint64_t droppedSentenceCount(std::string_view name) const;
+	std::vector<std::pair<std::string, uint64_t>> getDroppedSentenceCounts() const;	// name and count, sorted by name
+	void clearDroppedSentenceCounts();
 
 	// Byte streaming functions
 	void readByte		(uint8_t b);
-	void readBuffer		(uint8_t* b, uint32_t size);
+	void readBuffer		(const uint8_t* b, uint32_t size);	// same result as calling readByte on every byte, without the per-byte cost
 	void readLine		(std::string line);
 
 	// This function expects the data to be a single line with an actual sentence in it, else it throws an error.
-	void readSentence	(std::string cmd);				// called when parser receives a sentence from the byte stream. Can also be called by user to inject sentences.
-
-	static uint8_t calculateChecksum(std::string);		// returns checksum of string -- XOR
+	// The sentence given to the handlers is only valid for the duration of the call, copy it to keep it.
+	void readSentence	(std::string_view cmd);			// called when parser receives a sentence from the byte stream. Can also be called by user to inject sentences.
+
+	// Same as above, but failures are returned instead of thrown (handlers set with
+	// setSentenceHandler may still throw). tryReadBuffer stops after the first failing
+	// sentence, consumed is the number of bytes of b it went through: up to the end of that
+	// sentence, or all of them.
+	NMEAParseResult tryReadByte		(uint8_t b);
+	NMEAParseResult tryReadBuffer	(const uint8_t* b, uint32_t size, uint32_t& consumed);
+	NMEAParseResult tryReadBuffer	(const uint8_t* b, uint32_t size);		// for a single line, or when the rest of b does not matter
+	NMEAParseResult tryReadSentence	(std::string_view cmd);
+
+	static uint8_t calculateChecksum(std::string_view);	// returns checksum of string -- XOR
 
 };
 
@@ -13,6 +13,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <exception>
 
@@ -37,9 +38,13 @@ public:
 
 
 
-double parseDouble(std::string s);
-int64_t parseInt(std::string s, int radix = 10);
-bool parseBool(std::string s);
+double parseDouble(std::string_view s);
+int64_t parseInt(std::string_view s, int radix = 10);
+bool parseBool(std::string_view s);
+
+// Same conversions, returning false instead of throwing.
+bool tryParseDouble(std::string_view s, double& d);
+bool tryParseInt(std::string_view s, int64_t& d, int radix = 10);
 
 //void NumberConversion_test();
 
@@ -0,0 +1,51 @@
+#ifndef PARALLELLOGREPLAY_H_
+#define PARALLELLOGREPLAY_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <nmeaparse/MappedFile.h>
+#include <nmeaparse/NMEAParser.h>
+#include <nmeaparse/INSService.h>
+#include <nmeaparse/INSRecords.h>
+#include <nmeaparse/LogReplay.h>
+#include <nmeaparse/Event.h>
+
+namespace nmea {
+
+// Offline counterpart of LogReplay for many cores. The log is cut into chunks at line
+// ends, each worker thread parses whole chunks with its own parser and INSService, and
+// the records of the chunks are handed out in file order on the calling thread.
+//
+// The records are the same as a sequential replay through one INSService publishing
+// them. Only their date depends on the sentences before the chunk, so the workers keep
+// a journal of their date tracking and it is done again in order before the records of
+// a chunk are handed out.
+class ParallelLogReplay {
+public:
+	ParallelLogReplay();
+	virtual ~ParallelLogReplay();
+
+	size_t threads;			// worker threads, 0 for one per core (the default)
+	size_t chunkSize;		// bytes per chunk, rounded up to the next line end. 4 MiB by default.
+	bool sequentialHint;	// see LogReplay, on by default
+
+	INSDateTracker date;	// dates the records like INSService::date would, set the start date here
+
+	// Called for every worker before the replay, from the calling thread: prefilter,
+	// sentence readers to disable... Events of the service would be called on the worker
+	// threads out of order, use onRecord instead. The service publishes to the replay.
+	std::function<void(NMEAParser&, INSService&)> setup;
+
+	Event<void(const INSRecord&)> onRecord;				// in file order, on the calling thread
+	Event<void(const LogReplayStats&)> onProgress;		// after the records of every chunk
+
+	// Exceptions thrown by handlers on the workers come through after the records of
+	// the chunk that threw, as with LogReplay.
+	LogReplayStats replay(const MappedFile& file);
+	LogReplayStats replay(const uint8_t* data, size_t size);
+};
+
+}
+
+#endif /* PARALLELLOGREPLAY_H_ */
@@ -0,0 +1,170 @@
+/*
+ * RecordQueue.h
+ *
+ *  Bounded lock-free queues to hand records from the parsing thread to consumers,
+ *  so a slow consumer does not stall the receive path.
+ *
+ *  See the license file included with this source.
+ */
+
+#ifndef RECORDQUEUE_H_
+#define RECORDQUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+
+namespace nmea {
+
+// What push does when the queue is full
+enum class OverflowPolicy : uint8_t {
+	Block,				// waits for a consumer to make room
+	DropNewest,			// refuses the new value
+	OverwriteOldest		// drops the oldest value to make room
+};
+
+
+// Ring of cells with a sequence number each (Vyukov's bounded queue). The sequence
+// tells whether a cell is free for the push at a position or filled for the pop at
+// it, so a value is never read while written. Pops always claim their position with
+// a CAS, which lets the producer pop the oldest value itself for OverwriteOldest.
+// Pushes do too when there are several producers.
+template <class T, bool MultiProducer>
+class RecordQueue {
+	static_assert(std::is_trivially_copyable<T>::value, "values are copied in and out of the cells");
+private:
+	struct Cell {
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	std::unique_ptr<Cell[]> cells;
+	uint64_t mask;
+	OverflowPolicy policy;
+
+	alignas(64) std::atomic<uint64_t> pushPosition;
+	alignas(64) std::atomic<uint64_t> popPosition;
+	alignas(64) std::atomic<uint64_t> lost;		// dropped or overwritten values
+
+	static uint64_t roundUp(size_t n){
+		uint64_t size = 2;
+		while (size < n){
+			size <<= 1;
+		}
+		return size;
+	}
+
+public:
+	// The capacity is rounded up to a power of 2.
+	RecordQueue(size_t capacity, OverflowPolicy overflow = OverflowPolicy::DropNewest)
+		: cells(new Cell[roundUp(capacity)])
+		, mask(roundUp(capacity) - 1)
+		, policy(overflow)
+		, pushPosition(0)
+		, popPosition(0)
+		, lost(0)
+	{
+		for (uint64_t i = 0; i <= mask; i++){
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	RecordQueue(const RecordQueue&) = delete;
+	RecordQueue& operator=(const RecordQueue&) = delete;
+
+	// False when the queue is full, whatever the policy.
+	bool tryPush(const T& value){
+		uint64_t position = pushPosition.load(std::memory_order_relaxed);
+		while (true){
+			Cell& cell = cells[position & mask];
+			int64_t diff = (int64_t)(cell.sequence.load(std::memory_order_acquire) - position);
+			if (diff == 0){
+				if (!MultiProducer){
+					pushPosition.store(position + 1, std::memory_order_relaxed);
+				}
+				else if (!pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+					continue;
+				}
+				cell.value = value;
+				cell.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+			if (diff < 0){
+				return false;
+			}
+			position = pushPosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	// False when the queue is empty.
+	bool tryPop(T& value){
+		uint64_t position = popPosition.load(std::memory_order_relaxed);
+		while (true){
+			Cell& cell = cells[position & mask];
+			int64_t diff = (int64_t)(cell.sequence.load(std::memory_order_acquire) - (position + 1));
+			if (diff == 0){
+				if (!popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)){
+					continue;
+				}
+				value = cell.value;
+				cell.sequence.store(position + mask + 1, std::memory_order_release);
+				return true;
+			}
+			if (diff < 0){
+				return false;
+			}
+			position = popPosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	// Applies the overflow policy, false only when the value was dropped.
+	bool push(const T& value){
+		while (!tryPush(value)){
+			switch (policy){
+			case OverflowPolicy::Block:
+				std::this_thread::yield();
+				break;
+			case OverflowPolicy::DropNewest:
+				lost.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			case OverflowPolicy::OverwriteOldest:{
+				T oldest;
+				if (tryPop(oldest)){
+					lost.fetch_add(1, std::memory_order_relaxed);
+				}
+				break;
+			}
+			}
+		}
+		return true;
+	}
+
+	bool pop(T& value){
+		return tryPop(value);
+	}
+
+	size_t capacity() const {
+		return (size_t)mask + 1;
+	}
+
+	size_t size() const {		// approximate while other threads push or pop
+		uint64_t pushed = pushPosition.load(std::memory_order_acquire);
+		uint64_t popped = popPosition.load(std::memory_order_acquire);
+		return pushed > popped ? (size_t)(pushed - popped) : 0;
+	}
+
+	uint64_t lostCount() const {
+		return lost.load(std::memory_order_relaxed);
+	}
+};
+
+template <class T> using SPSCQueue = RecordQueue<T, false>;		// one pushing thread, one popping thread
+template <class T> using MPMCQueue = RecordQueue<T, true>;		// any number of each
+
+}
+
+#endif /* RECORDQUEUE_H_ */
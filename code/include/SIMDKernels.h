@@ -0,0 +1,33 @@
+/*
+ * SIMDKernels.h
+ *
+ *  Byte kernels used on every sentence the parser reads, and on every block of the
+ *  record log. Each one has SIMD versions on x86, picked once at runtime, and a
+ *  scalar fallback.
+ *
+ *  See the license file included with this source.
+ */
+
+#ifndef SIMDKERNELS_H_
+#define SIMDKERNELS_H_
+
+#include <cstdint>
+#include <cstddef>
+
+
+namespace nmea {
+
+// XOR of all the bytes, that is the NMEA checksum of the text between '$' and '*'.
+uint8_t xorChecksum(const char* data, size_t size);
+
+// Index of the first byte that cannot appear in the parameters of a sentence, or size if there is none.
+// Allowed are ASCII letters and digits, '+', '-', '.' and the ',' separating the parameters.
+size_t findInvalidParamChar(const char* data, size_t size);
+
+// CRC-32C (Castagnoli) of the bytes, continuing the crc of the bytes before them.
+// The SSE4.2 version uses the crc32 instruction.
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+}
+
+#endif /* SIMDKERNELS_H_ */
@@ -0,0 +1,93 @@
+/*
+ * SeqLock.h
+ *
+ *  Latest value of a trivially copyable type, written by one thread and read by any
+ *  number of threads. The writer never waits, readers retry while a write is in progress.
+ *
+ *  See the license file included with this source.
+ */
+
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+
+namespace nmea {
+
+template <class T>
+class SeqLock {
+	static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies the value as bytes");
+private:
+	static const size_t Words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+	// The value is copied word by word with relaxed atomics, so a torn read is only
+	// thrown away, never a data race. Odd sequence numbers mark a write in progress.
+	alignas(64) std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> words[Words];
+
+public:
+	SeqLock(const T& value = T())
+		: sequence(0)
+	{
+		uint64_t buffer[Words] = {};
+		std::memcpy(buffer, &value, sizeof(T));
+		for (size_t i = 0; i < Words; i++){
+			words[i].store(buffer[i], std::memory_order_relaxed);
+		}
+	}
+
+	SeqLock(const SeqLock&) = delete;
+	SeqLock& operator=(const SeqLock&) = delete;
+
+	// Only one thread may store.
+	void store(const T& value){
+		uint64_t buffer[Words] = {};
+		std::memcpy(buffer, &value, sizeof(T));
+
+		uint64_t s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (size_t i = 0; i < Words; i++){
+			words[i].store(buffer[i], std::memory_order_relaxed);
+		}
+		sequence.store(s + 2, std::memory_order_release);
+	}
+
+	// Any thread, returns the last complete store.
+	T load() const {
+		T value;
+		while (!tryLoad(value)){
+		}
+		return value;
+	}
+
+	// Single attempt, false when it overlapped a store.
+	bool tryLoad(T& value) const {
+		uint64_t buffer[Words];
+		uint64_t before = sequence.load(std::memory_order_acquire);
+		if (before & 1){
+			return false;
+		}
+		for (size_t i = 0; i < Words; i++){
+			buffer[i] = words[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) != before){
+			return false;
+		}
+		std::memcpy(&value, buffer, sizeof(T));
+		return true;
+	}
+
+	uint64_t version() const {		// changes with every store
+		return sequence.load(std::memory_order_acquire) / 2;
+	}
+};
+
+}
+
+#endif /* SEQLOCK_H_ */
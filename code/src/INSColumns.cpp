@@ -0,0 +1,433 @@
+#include <nmeaparse/INSColumns.h>
+#include <nmeaparse/NumberConversion.h>
+#include <nmeaparse/SIMDKernels.h>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+
+using namespace nmea;
+
+
+// ------------- COLUMNS -------------
+
+INSColumns::INSColumns(size_t capacity)
+: size(0)
+, valid((capacity + 63) / 64, 0)
+, rows(capacity)
+{ }
+
+size_t INSColumns::capacity() const {
+	return rows;
+}
+
+bool INSColumns::full() const {
+	return size >= rows;
+}
+
+bool INSColumns::isValid(size_t row) const {
+	return (valid[row / 64] >> (row % 64)) & 1;
+}
+
+size_t INSColumns::validCount() const {
+	size_t count = 0;
+	for (size_t row = 0; row < size; row++){
+		count += isValid(row);
+	}
+	return count;
+}
+
+void INSColumns::clear(){
+	size = 0;
+	fill(valid.begin(), valid.end(), 0);
+}
+
+void INSColumns::setValid(size_t row, bool v){
+	if (v){
+		valid[row / 64] |= uint64_t(1) << (row % 64);
+	}
+	else{
+		valid[row / 64] &= ~(uint64_t(1) << (row % 64));
+	}
+}
+
+AIPOVColumns::AIPOVColumns(size_t capacity)
+: INSColumns(capacity)
+, time(capacity)
+, heading(capacity), roll(capacity), pitch(capacity)
+, rotation_rate_xv1(capacity), rotation_rate_xv2(capacity), rotation_rate_xv3(capacity)
+, linear_acceleration_xv1(capacity), linear_acceleration_xv2(capacity), linear_acceleration_xv3(capacity)
+, latitude(capacity), longitude(capacity), altitude(capacity)
+, north_velocity(capacity), east_velocity(capacity), vertical_velocity(capacity)
+, along_velocity_xv1(capacity), across_velocity_xv2(capacity), down_velocity_xv3(capacity)
+, true_course(capacity)
+, user_status(capacity)
+{ }
+
+TECHSASColumns::TECHSASColumns(size_t capacity)
+: INSColumns(capacity)
+, time(capacity)
+, heading(capacity), roll(capacity), pitch(capacity), heave(capacity)
+, roll_standard_deviation(capacity), pitch_standard_deviation(capacity), heading_standard_deviation(capacity)
+, true_heading(capacity), x(capacity), y(capacity)
+{ }
+
+IXSEA_TAHColumns::IXSEA_TAHColumns(size_t capacity)
+: INSColumns(capacity)
+, time(capacity)
+, protocol_version_id(capacity), latency(capacity)
+, utc_time_status(capacity), true_heading_status(capacity), roll_status(capacity), pitch_status(capacity), heave_status(capacity)
+, true_heading(capacity), roll(capacity), pitch(capacity)
+, heave_no_lever_arms(capacity), heave(capacity), surge(capacity), sway(capacity)
+, heave_speed(capacity), surge_speed(capacity), sway_speed(capacity)
+, heading_rate(capacity)
+{ }
+
+
+// ------------- COLUMN READER -------------
+
+// Same rules as the ParameterReader of INSService: the parameters are read in order and
+// the first one that does not parse fails the row. Values not read are NaN (0 for integers).
+class ColumnReader {
+private:
+	const string_view* parameters;
+public:
+	bool ok;
+
+	ColumnReader(const string_view* p, bool checked)
+		: parameters(p), ok(checked)
+	{}
+
+	bool number(size_t i, double& value){
+		if (ok && tryParseDouble(parameters[i], value)){
+			return true;
+		}
+		ok = false;
+		value = numeric_limits<double>::quiet_NaN();
+		return false;
+	}
+
+	bool time(size_t i, INSTimestamp& timestamp){
+		if (ok && timestamp.setTime(parameters[i])){
+			return true;
+		}
+		double d;
+		if (number(i, d)){
+			timestamp.setTime(d);
+		}
+		return ok;
+	}
+
+	bool flag(size_t i, uint8_t& value){
+		if (ok && parameters[i].size() == 1 && (parameters[i][0] == '0' || parameters[i][0] == '1')){
+			value = parameters[i][0] == '1';
+			return true;
+		}
+		double d;
+		value = number(i, d) && d != 0;
+		return ok;
+	}
+
+	bool integer(size_t i, int32_t& value){
+		int64_t d;
+		if (ok && tryParseInt(parameters[i], d)){
+			value = (int32_t)d;
+			return true;
+		}
+		ok = false;
+		value = 0;
+		return false;
+	}
+
+	// ns since Jan 1, 1970 of the time of day at i, dated by the tracker
+	int64_t datedTime(size_t i, INSDateTracker& date){
+		INSTimestamp timestamp;
+		if (!time(i, timestamp)){
+			return 0;
+		}
+		date.track(timestamp);
+		return timestamp.timePoint().time_since_epoch().count();
+	}
+};
+
+
+// ------------- BATCH PARSER -------------
+
+INSBatchParser::INSBatchParser()
+: aipov(nullptr)
+, techsas(nullptr)
+, ixsea_tah(nullptr)
+{
+	// lines that are not plain, the rows come out the same through the parser
+	parser.prefilter = true;
+	parser.setSentenceReader("AIPOV", [this](const NMEASentence& nmea){
+		this->read_AIPOV(nmea.parameters.data(), nmea.parameters.size(), nmea.checksumOK());
+		return NMEAParseResult();
+	});
+	parser.setSentenceReader("PASHR", [this](const NMEASentence& nmea){
+		this->read_TECHSAS(nmea.parameters.data(), nmea.parameters.size(), nmea.checksumOK());
+		return NMEAParseResult();
+	});
+	parser.setSentenceReader("PHOCT", [this](const NMEASentence& nmea){
+		this->read_IXSEA_TAH(nmea.parameters.data(), nmea.parameters.size(), nmea.checksumOK());
+		return NMEAParseResult();
+	});
+	parser.setSentenceReader("GPZDA", [this](const NMEASentence& nmea){
+		this->read_ZDA(nmea.parameters.data(), nmea.parameters.size(), nmea.checksumOK());
+		return NMEAParseResult();
+	});
+	parser.setSentenceReader("INZDA", [this](const NMEASentence& nmea){
+		this->read_ZDA(nmea.parameters.data(), nmea.parameters.size(), nmea.checksumOK());
+		return NMEAParseResult();
+	});
+}
+
+INSBatchParser::~INSBatchParser()
+{ }
+
+size_t INSBatchParser::parseBatch(const uint8_t* data, size_t size, AIPOVColumns& columns){
+	aipov = &columns;
+	size_t consumed = parse(data, size, columns);
+	aipov = nullptr;
+	return consumed;
+}
+
+size_t INSBatchParser::parseBatch(const uint8_t* data, size_t size, TECHSASColumns& columns){
+	techsas = &columns;
+	size_t consumed = parse(data, size, columns);
+	techsas = nullptr;
+	return consumed;
+}
+
+size_t INSBatchParser::parseBatch(const uint8_t* data, size_t size, IXSEA_TAHColumns& columns){
+	ixsea_tah = &columns;
+	size_t consumed = parse(data, size, columns);
+	ixsea_tah = nullptr;
+	return consumed;
+}
+
+template <class Columns>
+size_t INSBatchParser::parse(const uint8_t* data, size_t size, Columns& columns){
+	const char* begin = reinterpret_cast<const char*>(data);
+	size_t position = 0;
+	while (position < size && !columns.full()){
+		const char* line = begin + position;
+		const char* newline = static_cast<const char*>(memchr(line, '\n', size - position));
+		if (newline == nullptr){
+			break;
+		}
+		size_t length = newline + 1 - line;
+		if (!readPlain(line, length)){
+			parser.tryReadBuffer(reinterpret_cast<const uint8_t*>(line), (uint32_t)length);
+		}
+		position += length;
+	}
+	return position;
+}
+
+static bool isHex(char c){
+	return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+static uint8_t hexValue(char c){
+	return (c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+// A plain line is "...$NAME,p,p,...,p*hh\r\n" with only parameter characters after the
+// '$', the parser would tokenize it the obvious way. Lines of other sentences are done
+// as soon as the name is known.
+bool INSBatchParser::readPlain(const char* line, size_t size){
+	const size_t MaxParameters = 32;
+
+	size--;			// newline
+	if (size > 0 && line[size - 1] == '\r'){
+		size--;
+	}
+	const char* dollar = static_cast<const char*>(memchr(line, '$', size));
+	if (dollar == nullptr){
+		return true;		// the parser ignores it too
+	}
+	const char* end = line + size;
+	if (end - dollar > 1024){
+		return false;		// near the size the parser drops a sentence at
+	}
+
+	const char* text = dollar + 1;
+	if (memchr(text, '$', end - text) != nullptr){
+		return false;		// the sentence starts at the last one
+	}
+	const char* comma = static_cast<const char*>(memchr(text, ',', end - text));
+	if (comma == nullptr){
+		return false;
+	}
+	string_view sentence(text, comma - text);
+	void (INSBatchParser::*reader)(const string_view*, size_t, bool);
+	if (sentence == "AIPOV"){
+		reader = &INSBatchParser::read_AIPOV;
+	}
+	else if (sentence == "PASHR"){
+		reader = &INSBatchParser::read_TECHSAS;
+	}
+	else if (sentence == "PHOCT"){
+		reader = &INSBatchParser::read_IXSEA_TAH;
+	}
+	else if (sentence == "GPZDA" || sentence == "INZDA"){
+		reader = &INSBatchParser::read_ZDA;
+	}
+	else{
+		return findInvalidParamChar(text, comma - text) == (size_t)(comma - text);		// else whitespace could hide the name
+	}
+
+	// checksum, exactly 2 hex digits after the only '*'
+	const char* star = (end - text >= 3 && end[-3] == '*') ? end - 3 : end;
+	bool checksumOK = false;
+	if (star != end){
+		if (!isHex(star[1]) || !isHex(star[2])){
+			return false;
+		}
+		checksumOK = xorChecksum(text, star - text) == (uint8_t)(hexValue(star[1]) * 16 + hexValue(star[2]));
+	}
+	else if (memchr(text, '*', end - text) != nullptr){
+		return false;
+	}
+	if (findInvalidParamChar(comma, star - comma) != (size_t)(star - comma)){
+		return false;
+	}
+
+	string_view parameters[MaxParameters];
+	size_t n = 0;
+	const char* field = comma + 1;
+	while (true){
+		const char* next = static_cast<const char*>(memchr(field, ',', star - field));
+		if (n == MaxParameters){
+			return false;
+		}
+		if (next == nullptr){
+			parameters[n++] = string_view(field, star - field);
+			break;
+		}
+		parameters[n++] = string_view(field, next - field);
+		field = next + 1;
+	}
+
+	(this->*reader)(parameters, n, checksumOK);
+	return true;
+}
+
+void INSBatchParser::read_AIPOV(const string_view* p, size_t n, bool checksumOK){
+	ColumnReader read(p, checksumOK && n >= 21);
+	if (aipov == nullptr){
+		read.datedTime(0, date);		// the other sentences date the rows too
+		return;
+	}
+	AIPOVColumns& c = *aipov;
+	size_t row = c.size++;
+
+	c.time[row] = read.datedTime(0, date);
+
+	read.number(1, c.heading[row]);
+	read.number(2, c.roll[row]);
+	read.number(3, c.pitch[row]);
+
+	read.number(4, c.rotation_rate_xv1[row]);
+	read.number(5, c.rotation_rate_xv2[row]);
+	read.number(6, c.rotation_rate_xv3[row]);
+
+	read.number(7, c.linear_acceleration_xv1[row]);
+	read.number(8, c.linear_acceleration_xv2[row]);
+	read.number(9, c.linear_acceleration_xv3[row]);
+
+	read.number(10, c.latitude[row]);
+	read.number(11, c.longitude[row]);
+	read.number(12, c.altitude[row]);
+
+	read.number(13, c.north_velocity[row]);
+	read.number(14, c.east_velocity[row]);
+	read.number(15, c.vertical_velocity[row]);
+
+	read.number(16, c.along_velocity_xv1[row]);
+	read.number(17, c.across_velocity_xv2[row]);
+	read.number(18, c.down_velocity_xv3[row]);
+
+	c.user_status[row] = read.number(19, c.true_course[row]) ? parseINSUserStatus(p[20]).bits : 0;
+
+	c.setValid(row, read.ok);
+}
+
+void INSBatchParser::read_TECHSAS(const string_view* p, size_t n, bool checksumOK){
+	ColumnReader read(p, checksumOK && n >= 11);
+	if (techsas == nullptr){
+		read.datedTime(0, date);
+		return;
+	}
+	TECHSASColumns& c = *techsas;
+	size_t row = c.size++;
+
+	c.time[row] = read.datedTime(0, date);
+
+	c.true_heading[row] = read.number(1, c.heading[row]) && p[2] == "T";
+
+	read.number(3, c.roll[row]);
+	read.number(4, c.pitch[row]);
+	read.number(5, c.heave[row]);
+
+	read.number(6, c.roll_standard_deviation[row]);
+	read.number(7, c.pitch_standard_deviation[row]);
+	read.number(8, c.heading_standard_deviation[row]);
+
+	read.flag(9, c.x[row]);
+	read.flag(10, c.y[row]);
+
+	c.setValid(row, read.ok);
+}
+
+void INSBatchParser::read_IXSEA_TAH(const string_view* p, size_t n, bool checksumOK){
+	ColumnReader read(p, checksumOK && n >= 19);
+	double version;
+	if (ixsea_tah == nullptr){
+		read.number(0, version);
+		read.datedTime(1, date);
+		return;
+	}
+	IXSEA_TAHColumns& c = *ixsea_tah;
+	size_t row = c.size++;
+
+	c.protocol_version_id[row] = read.number(0, version) ? (int32_t)version : 0;
+
+	c.time[row] = read.datedTime(1, date);
+	c.utc_time_status[row] = read.ok ? parseINSStatus(p[2]) : INSStatus::Unknown;
+
+	read.integer(3, c.latency[row]);
+
+	c.true_heading_status[row] = read.number(4, c.true_heading[row]) ? parseINSStatus(p[5]) : INSStatus::Unknown;
+	c.roll_status[row] = read.number(6, c.roll[row]) ? parseINSStatus(p[7]) : INSStatus::Unknown;
+	c.pitch_status[row] = read.number(8, c.pitch[row]) ? parseINSStatus(p[9]) : INSStatus::Unknown;
+	c.heave_status[row] = read.number(10, c.heave_no_lever_arms[row]) ? parseINSStatus(p[11]) : INSStatus::Unknown;
+
+	read.number(12, c.heave[row]);
+	read.number(13, c.surge[row]);
+	read.number(14, c.sway[row]);
+
+	read.number(15, c.heave_speed[row]);
+	read.number(16, c.surge_speed[row]);
+	read.number(17, c.sway_speed[row]);
+
+	read.number(18, c.heading_rate[row]);
+
+	c.setValid(row, read.ok);
+}
+
+void INSBatchParser::read_ZDA(const string_view* p, size_t n, bool checksumOK){
+	ColumnReader read(p, checksumOK && n >= 4);
+
+	INSTimestamp timestamp;
+	int32_t day, month, year;
+	read.time(0, timestamp);
+	read.integer(1, day);
+	read.integer(2, month);
+	read.integer(3, year);
+	if (read.ok){
+		date.setDate(year, month, day);
+		date.track(timestamp);
+	}
+}
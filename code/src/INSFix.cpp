@@ -15,11 +15,35 @@ using namespace nmea;
 // ===========================================================
 
 
+// Counts in eras of 400 years, starting the year in March so the leap day is the last one.
+int64_t nmea::daysFromCivil(int32_t year, int32_t month, int32_t day){
+	int64_t y = (int64_t)year - (month <= 2);
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int64_t yoe = y - era * 400;						// [0, 399]
+	int64_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;	// [0, 365]
+	int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;		// [0, 146096]
+	return era * 146097 + doe - 719468;
+}
+
+void nmea::civilFromDays(int64_t days, int32_t& year, int32_t& month, int32_t& day){
+	days += 719468;
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int64_t doe = days - era * 146097;						// [0, 146096]
+	int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;	// [0, 399]
+	int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);		// [0, 365]
+	int64_t mp = (5 * doy + 2) / 153;						// [0, 11], from March
+	day = (int32_t)(doy - (153 * mp + 2) / 5 + 1);
+	month = (int32_t)(mp < 10 ? mp + 3 : mp - 9);
+	year = (int32_t)(yoe + era * 400 + (month <= 2));
+}
+
+
 INSTimestamp::INSTimestamp(){
 	hour = 0;
 	min = 0;
 	sec = 0;
 	microsec = 0;
+	nanosec = 0;
 
 	month = 1;
 	day = 1;
@@ -55,15 +79,12 @@ std::string INSTimestamp::monthName(uint32_t index){
 };
 
 // Returns seconds since Jan 1, 1970. Classic Epoch time.
-time_t INSTimestamp::getTime() {
-	struct tm t = { 0 };
-	t.tm_year = year - 1900;	// This is year-1900, so 112 = 2012
-	t.tm_mon = month;			// month from 0:Jan
-	t.tm_mday = day;
-	t.tm_hour = hour;
-	t.tm_min = min;
-	t.tm_sec = (int)sec;
-	return mktime(&t);
+time_t INSTimestamp::getTime() const {
+	return (time_t)duration_cast<seconds>(timePoint().time_since_epoch()).count();
+}
+
+INSTimestamp::TimePoint INSTimestamp::timePoint() const {
+	return TimePoint(duration_cast<nanoseconds>(hours(24 * daysFromCivil(year, month, day))) + timeOfDay());
 }
 
 void INSTimestamp::setTime(double raw_ts){
@@ -73,6 +94,48 @@ void INSTimestamp::setTime(double raw_ts){
 	min = (int32_t)trunc((trunc(raw_ts) - hour * 10000) / 100.0);
 	sec = (int32_t)trunc(trunc(raw_ts) - min * 100 - hour * 10000);
 	microsec = (int32_t)round((raw_ts - trunc(raw_ts)) * 1000000);
+	nanosec = microsec * 1000;
+}
+
+bool INSTimestamp::setTime(std::string_view raw_ts){
+	size_t i = 0;
+	int32_t whole = 0;
+	for (; i < raw_ts.size() && raw_ts[i] >= '0' && raw_ts[i] <= '9'; i++){
+		if (i == 9){
+			return false;
+		}
+		whole = whole * 10 + (raw_ts[i] - '0');
+	}
+	if (i == 0){
+		return false;
+	}
+
+	// digits past the nanosecond are dropped
+	int32_t fraction = 0;
+	int32_t scale = 1000000000;
+	if (i < raw_ts.size() && raw_ts[i] == '.'){
+		for (i++; i < raw_ts.size() && raw_ts[i] >= '0' && raw_ts[i] <= '9'; i++){
+			if (scale > 1){
+				scale /= 10;
+				fraction += (raw_ts[i] - '0') * scale;
+			}
+		}
+	}
+	if (i != raw_ts.size()){
+		return false;
+	}
+
+	rawTime = whole;
+	hour = whole / 10000;
+	min = whole / 100 % 100;
+	sec = whole % 100;
+	nanosec = fraction;
+	microsec = (fraction + 500) / 1000;
+	return true;
+}
+
+std::chrono::nanoseconds INSTimestamp::timeOfDay() const {
+	return hours(hour) + minutes(min) + seconds(sec) + nanoseconds(nanosec);
 }
 
 //ddmmyy
@@ -91,6 +154,15 @@ void INSTimestamp::setDate(int32_t raw_date){
 	}
 }
 
+int64_t INSTimestamp::days() const {
+	return daysFromCivil(year, month, day);
+}
+
+void INSTimestamp::setDays(int64_t days){
+	civilFromDays(days, year, month, day);
+	rawDate = day * 10000 + month * 100 + year % 100;
+}
+
 std::string INSTimestamp::toString(){
 	std::stringstream ss;
 	ss << hour << "h " << min << "m " << sec << "s " << microsec << "*10e-6s UTC " << "(" << monthName(month) << " " << day << " " << year << ")";
@@ -99,6 +171,74 @@ std::string INSTimestamp::toString(){
 
 
 
+// ===========================================================
+// ======================== INS DATE TRACKER =================
+// ===========================================================
+
+
+INSDateTracker::INSDateTracker()
+: day(0)
+, last(0)
+, started(false)
+, lateRun(0)
+, maxBackwardJump(hours(12))
+, maxLateness(minutes(1))
+, maxLateSentences(8)
+, journal(nullptr)
+{ }
+
+void INSDateTracker::setDate(int32_t year, int32_t month, int32_t d){
+	setDate(daysFromCivil(year, month, d));
+}
+
+void INSDateTracker::setDate(int64_t days){
+	day = days;
+	started = false;
+	lateRun = 0;
+	if (journal != nullptr){
+		journal->push_back(Step{ false, day, nanoseconds(0) });
+	}
+}
+
+void INSDateTracker::track(INSTimestamp& timestamp){
+	timestamp.setDays(track(timestamp.timeOfDay()));
+}
+
+int64_t INSDateTracker::track(nanoseconds t){
+	int64_t d = day;
+	if (!started){
+		started = true;
+		last = t;
+	}
+	else if (t < last - maxBackwardJump){
+		day++;			// midnight passed
+		d = day;
+		last = t;
+		lateRun = 0;
+	}
+	else if (last < maxLateness && t >= hours(24) - maxLateness){
+		if (++lateRun <= maxLateSentences){
+			d = day - 1;	// late sentence from before midnight
+		}
+		else{
+			last = t;		// the recording went on from there
+			lateRun = 0;
+		}
+	}
+	else{
+		if (t > last){
+			last = t;
+		}
+		lateRun = 0;
+	}
+	if (journal != nullptr){
+		journal->push_back(Step{ true, d, t });
+	}
+	return d;
+}
+
+
+
 // =====================================================
 // ======================== INS FIX ====================
 // =====================================================
@@ -133,11 +273,11 @@ INSFix::INSFix() {
 
 	true_course = 0;
 
-	user_status = "";
+	user_status = INSUserStatus{ 0 };
 
 	// =========================== TECHSAS =====================================
 
-	T = "T";
+	T = true;
 
 	heave = 0;
 
@@ -152,18 +292,18 @@ INSFix::INSFix() {
 
 	protocol_version_id = 0;
 
-	utc_time_status = "T";
+	utc_time_status = INSStatus::Valid;
 
 	latency = 0;
 
 	true_heading = 0;
 	
-	true_heading_status = "T";
-	roll_status = "T";
-	pitch_status = "T";
+	true_heading_status = INSStatus::Valid;
+	roll_status = INSStatus::Valid;
+	pitch_status = INSStatus::Valid;
 
 	heave_no_lever_arms = 0;
-	std::string heave_status = "T";
+	heave_status = INSStatus::Valid;
 	
 	//heave = 0;
 	surge = 0;
@@ -178,11 +318,6 @@ INSFix::INSFix() {
 }
 
 
-INSFix::~INSFix() {
-	// TODO Auto-generated destructor stub
-}
-
-
 std::string INSFix::toString_AIPOV(){
 	
 	stringstream ss;
@@ -208,7 +343,7 @@ std::string INSFix::toString_AIPOV(){
 		<< "   [17]  Across Velocity XV2        : " << across_velocity_xv2 << " m/s" << endl
 		<< "   [18]  Down Velocity XV3          : " << down_velocity_xv3 << " m/s" << endl
 		<< "   [19]  True Course                : " << true_course << " deg" << endl
-		<< "   [20]  User Status                : " << user_status << endl;
+		<< "   [20]  User Status                : " << hex << uppercase << setw(8) << setfill('0') << user_status.bits << dec << nouppercase << setfill(' ') << endl;
 
 	return ss.str();
 }
@@ -221,7 +356,7 @@ std::string INSFix::toString_TECHSAS(){
 	ss << "================================= TECHSAS =================================" << endl
 		<< "   [ 0]  Timestamp                  : " << timestamp.toString() << endl
 		<< "   [ 1]  Heading                    : " << heading << " deg" << endl
-		<< "   [ 2]  Fixed Character            : " << T << endl
+		<< "   [ 2]  Fixed Character            : " << (T ? 'T' : '?') << endl
 		<< "   [ 3]  Roll                       : " << roll << " deg" << endl
 		<< "   [ 4]  Pitch                      : " << pitch << " deg" <<  endl
 		<< "   [ 5]  Heave                      : " << heave << " m" <<  endl
@@ -242,16 +377,16 @@ std::string INSFix::toString_IXSEA_TAH(){
 	ss << "================================= AIPOV =================================" << endl
 		<< "   [ 0]  Protocol version id        : " << protocol_version_id << endl
 		<< "   [ 1]  UTC Time                   : " << timestamp.toString() << endl
-		<< "   [ 2]  UTC Time Status            : " << utc_time_status << endl
+		<< "   [ 2]  UTC Time Status            : " << toChar(utc_time_status) << endl
 		<< "   [ 3]  Latency (for r/p/h)        : " << latency << endl
 		<< "   [ 4]  True Heading               : " << true_heading << " deg" <<  endl
-		<< "   [ 5]  True Heading Status        : " << true_heading_status << endl
+		<< "   [ 5]  True Heading Status        : " << toChar(true_heading_status) << endl
 		<< "   [ 6]  Roll                       : " << roll << " deg" <<  endl
-		<< "   [ 7]  Roll Status                : " << roll_status << endl
+		<< "   [ 7]  Roll Status                : " << toChar(roll_status) << endl
 		<< "   [ 8]  Pitch                      : " << pitch << " deg" << endl
-		<< "   [ 9]  Pitch Status               : " << pitch_status << " m/s2" << endl
+		<< "   [ 9]  Pitch Status               : " << toChar(pitch_status) << " m/s2" << endl
 		<< "   [10]  Heave (No Lever Arms)      : " << heave_no_lever_arms << " m" << endl
-		<< "   [11]  Heave Status               : " << heave_status << endl
+		<< "   [11]  Heave Status               : " << toChar(heave_status) << endl
 		<< "   [12]  Heave (Lever Arms)         : " << altitude << " m" << endl
 		<< "   [13]  Surge (Lever Arms)         : " << surge << " m" << endl
 		<< "   [14]  Sway (Lever Arms)          : " << sway << " m" << endl
@@ -0,0 +1,195 @@
+#include <nmeaparse/INSHistory.h>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+// ------------- INTERPOLATION -------------
+
+static const double DegToRad = M_PI / 180.0;
+static const double RadToDeg = 180.0 / M_PI;
+
+// a + f * (b - a), going the short way around a circle of the given period
+static double lerpAngle(double a, double b, double f, double period){
+	double d = fmod(b - a, period);
+	if (d > period / 2){
+		d -= period;
+	}
+	else if (d < -period / 2){
+		d += period;
+	}
+	return a + f * d;
+}
+
+// into [low, low + period)
+static double wrap(double angle, double low, double period){
+	double a = fmod(angle - low, period);
+	if (a < 0){
+		a += period;
+		if (a >= period){		// a was a tiny negative
+			a -= period;
+		}
+	}
+	return a + low;
+}
+
+struct Quaternion {
+	double w, x, y, z;
+
+	// heading, pitch, roll applied in that order (Z, Y, X)
+	static Quaternion fromAttitude(double heading, double pitch, double roll){
+		double cy = cos(heading * DegToRad / 2), sy = sin(heading * DegToRad / 2);
+		double cp = cos(pitch * DegToRad / 2), sp = sin(pitch * DegToRad / 2);
+		double cr = cos(roll * DegToRad / 2), sr = sin(roll * DegToRad / 2);
+		return Quaternion{
+			cr * cp * cy + sr * sp * sy,
+			sr * cp * cy - cr * sp * sy,
+			cr * sp * cy + sr * cp * sy,
+			cr * cp * sy - sr * sp * cy
+		};
+	}
+
+	void toAttitude(double& heading, double& pitch, double& roll) const {
+		roll = wrap(atan2(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * RadToDeg, -180, 360);
+		pitch = asin(max(-1.0, min(1.0, 2 * (w * y - z * x)))) * RadToDeg;
+		heading = wrap(atan2(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * RadToDeg, 0, 360);
+	}
+
+	static Quaternion slerp(Quaternion a, const Quaternion& b, double f){
+		double dot = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+		if (dot < 0){		// same rotation, the short way
+			a = Quaternion{ -a.w, -a.x, -a.y, -a.z };
+			dot = -dot;
+		}
+		double fa, fb;
+		if (dot > 0.9995){		// too close for the sine, the normalized lerp is as good
+			fa = 1 - f;
+			fb = f;
+		}
+		else{
+			double theta = acos(dot);
+			fa = sin((1 - f) * theta) / sin(theta);
+			fb = sin(f * theta) / sin(theta);
+		}
+		Quaternion q{ fa * a.w + fb * b.w, fa * a.x + fb * b.x, fa * a.y + fb * b.y, fa * a.z + fb * b.z };
+		double n = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+		return Quaternion{ q.w / n, q.x / n, q.y / n, q.z / n };
+	}
+};
+
+static INSPose interpolate(const INSPose& a, const INSPose& b, INSTimestamp::TimePoint time, INSInterpolation interpolation){
+	double f = (double)(time - a.time).count() / (double)(b.time - a.time).count();
+
+	INSPose pose;
+	pose.time = time;
+	pose.latitude = a.latitude + f * (b.latitude - a.latitude);
+	pose.longitude = wrap(lerpAngle(a.longitude, b.longitude, f, 360), -180, 360);
+	pose.altitude = a.altitude + f * (b.altitude - a.altitude);
+
+	if (interpolation == INSInterpolation::Slerp){
+		Quaternion q = Quaternion::slerp(Quaternion::fromAttitude(a.heading, a.pitch, a.roll), Quaternion::fromAttitude(b.heading, b.pitch, b.roll), f);
+		q.toAttitude(pose.heading, pose.pitch, pose.roll);
+	}
+	else{
+		pose.heading = wrap(lerpAngle(a.heading, b.heading, f, 360), 0, 360);
+		pose.roll = wrap(lerpAngle(a.roll, b.roll, f, 360), -180, 360);
+		pose.pitch = a.pitch + f * (b.pitch - a.pitch);
+	}
+	return pose;
+}
+
+
+// ------------- INS HISTORY -------------
+
+INSHistory::INSHistory()
+: size(0)
+, maxAge(0)
+, pushed(0)
+{ }
+
+void INSHistory::reset(size_t capacity, nanoseconds age){
+	slots.reset(capacity > 0 ? new SeqLock<Slot>[capacity] : nullptr);
+	size = capacity;
+	maxAge = age;
+	pushed.store(0, memory_order_release);
+	newest = INSTimestamp::TimePoint();
+}
+
+size_t INSHistory::capacity() const {
+	return size;
+}
+
+bool INSHistory::push(const INSPose& pose){
+	uint64_t index = pushed.load(memory_order_relaxed);
+	if (size == 0 || (index > 0 && pose.time <= newest)){
+		return false;
+	}
+	slots[index % size].store(Slot{ index, pose });
+	newest = pose.time;
+	pushed.store(index + 1, memory_order_release);
+	return true;
+}
+
+bool INSHistory::read(uint64_t index, Slot& slot) const {
+	slot = slots[index % size].load();
+	return slot.index == index;
+}
+
+bool INSHistory::latest(INSPose& pose) const {
+	uint64_t end = pushed.load(memory_order_acquire);
+	Slot slot;
+	if (end == 0 || !read(end - 1, slot)){
+		return false;
+	}
+	pose = slot.pose;
+	return true;
+}
+
+bool INSHistory::query(INSTimestamp::TimePoint time, INSPose& pose, INSInterpolation interpolation) const {
+	uint64_t end = pushed.load(memory_order_acquire);
+	if (end == 0){
+		return false;
+	}
+	uint64_t begin = (end > size) ? end - size : 0;
+
+	Slot last;
+	if (!read(end - 1, last) || time > last.pose.time){
+		return false;
+	}
+	if (time == last.pose.time){
+		pose = last.pose;
+		return true;
+	}
+
+	// first push newer than time, a slot already overwritten is older than anything kept
+	uint64_t lo = begin, hi = end - 1;
+	while (lo < hi){
+		uint64_t mid = lo + (hi - lo) / 2;
+		Slot slot;
+		if (!read(mid, slot) || slot.pose.time <= time){
+			lo = mid + 1;
+		}
+		else{
+			hi = mid;
+		}
+	}
+
+	Slot before, after;
+	if (lo == begin || !read(lo - 1, before) || !read(lo, after)){
+		return false;
+	}
+	if (maxAge.count() > 0 && last.pose.time - before.pose.time > maxAge){
+		return false;
+	}
+	if (before.pose.time == time){
+		pose = before.pose;
+		return true;
+	}
+
+	pose = interpolate(before.pose, after.pose, time, interpolation);
+	return true;
+}
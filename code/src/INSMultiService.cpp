@@ -0,0 +1,200 @@
+#include <nmeaparse/INSMultiService.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+// The service of the source whose chunk the worker thread is parsing
+static thread_local INSService* parsing = nullptr;
+
+INSMultiService::Source::Source(uint32_t i, NMEAParser& readers)
+: id(i)
+, index(0)
+, shard(0)
+, parser()
+, service()
+, errors(0)
+{
+	parser.shareSentenceReaders(readers);
+}
+
+INSMultiService::Shard::Shard(size_t capacity, OverflowPolicy overflow)
+: queue(capacity, overflow)
+{ }
+
+
+INSMultiService::INSMultiService(size_t shardCount, size_t queueCapacity, OverflowPolicy overflow)
+: running(false)
+, stopping(false)
+, submitting(0)
+{
+	if (shardCount == 0){
+		shardCount = max(1u, thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < shardCount; i++){
+		shards.emplace_back(new Shard(queueCapacity, overflow));
+	}
+	INSService::attachToParser(readers, []{ return parsing; });
+}
+
+INSMultiService::~INSMultiService() {
+	stop();
+}
+
+INSService* INSMultiService::addSource(uint32_t id){
+	if (running.load()){
+		return nullptr;		// the workers and submit look sources up without a lock
+	}
+	Source* source = find(id);
+	if (source == nullptr){
+		auto it = lower_bound(sources.begin(), sources.end(), id, [](const unique_ptr<Source>& s, uint32_t i){
+			return s->id < i;
+		});
+		source = sources.insert(it, unique_ptr<Source>(new Source(id, readers)))->get();
+	}
+	return &source->service;
+}
+
+INSMultiService::Source* INSMultiService::find(uint32_t id) const {
+	auto it = lower_bound(sources.begin(), sources.end(), id, [](const unique_ptr<Source>& s, uint32_t i){
+		return s->id < i;
+	});
+	if (it == sources.end() || (*it)->id != id){
+		return nullptr;
+	}
+	return it->get();
+}
+
+INSService* INSMultiService::service(uint32_t id){
+	Source* source = find(id);
+	return source ? &source->service : nullptr;
+}
+
+NMEAParser* INSMultiService::parser(uint32_t id){
+	Source* source = find(id);
+	return source ? &source->parser : nullptr;
+}
+
+size_t INSMultiService::shardCount() const {
+	return shards.size();
+}
+
+void INSMultiService::start(){
+	if (running.load()){
+		return;
+	}
+	// round robin in id order, so a few sources still land on different shards
+	for (size_t i = 0; i < sources.size(); i++){
+		sources[i]->index = (uint32_t)i;
+		sources[i]->shard = i % shards.size();
+	}
+	stopping.store(false);
+	running.store(true);
+	for (auto& shard : shards){
+		Shard* s = shard.get();
+		s->worker = thread([this, s]{ work(*s); });
+	}
+}
+
+void INSMultiService::stop(){
+	// a submit either sees running false, or is counted in submitting and pushes before the drain
+	running.store(false);
+	while (submitting.load() > 0){
+		this_thread::yield();
+	}
+	stopping.store(true);
+	for (auto& shard : shards){
+		if (shard->worker.joinable()){
+			shard->worker.join();
+		}
+	}
+}
+
+bool INSMultiService::submit(uint32_t id, const uint8_t* data, size_t size){
+	Source* source = find(id);
+	if (source == nullptr){
+		return false;
+	}
+	submitting.fetch_add(1);
+	if (!running.load()){
+		submitting.fetch_sub(1);
+		return false;
+	}
+	Shard& shard = *shards[source->shard];
+
+	bool all = true;
+	Chunk chunk;
+	chunk.source = source->index;
+	while (size > 0){
+		chunk.size = (uint32_t)min(size, ChunkSize);
+		memcpy(chunk.data, data, chunk.size);
+		all = shard.queue.push(chunk) && all;
+		data += chunk.size;
+		size -= chunk.size;
+	}
+	submitting.fetch_sub(1);
+	return all;
+}
+
+void INSMultiService::parse(const Chunk& chunk){
+	Source& source = *sources[chunk.source];
+	parsing = &source.service;
+	const uint8_t* b = chunk.data;
+	uint32_t left = chunk.size;
+	try {
+		while (left > 0){
+			uint32_t consumed;
+			NMEAParseResult result = source.parser.tryReadBuffer(b, left, consumed);
+			if (result){
+				break;
+			}
+			source.errors.fetch_add(1, memory_order_relaxed);
+			b += consumed;
+			left -= consumed;
+		}
+	}
+	catch (exception&){
+		// a handler set with setSentenceHandler threw, the rest of the chunk is lost
+		source.errors.fetch_add(1, memory_order_relaxed);
+	}
+}
+
+void INSMultiService::work(Shard& shard){
+	Chunk chunk;
+	unsigned idle = 0;
+	while (true){
+		if (shard.queue.pop(chunk)){
+			idle = 0;
+			parse(chunk);
+			continue;
+		}
+		if (stopping.load()){
+			// everything submitted is in the queue by now
+			while (shard.queue.pop(chunk)){
+				parse(chunk);
+			}
+			return;
+		}
+		if (++idle < 64){
+			this_thread::yield();
+		}
+		else{
+			this_thread::sleep_for(microseconds(100));
+		}
+	}
+}
+
+INSFix INSMultiService::snapshot(uint32_t id) const {
+	Source* source = find(id);
+	return source ? source->service.snapshot() : INSFix();
+}
+
+uint64_t INSMultiService::errorCount(uint32_t id) const {
+	Source* source = find(id);
+	return source ? source->errors.load(memory_order_relaxed) : 0;
+}
@@ -0,0 +1,538 @@
+#include <nmeaparse/INSRecordLog.h>
+#include <nmeaparse/INSTimeIndex.h>
+#include <nmeaparse/SIMDKernels.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+// ------------- ENCODING -------------
+
+namespace {
+
+	const char FileMagic[8] = { 'I', 'N', 'S', 'R', 'L', 'O', 'G', 0 };
+
+	// Little endian whatever the host, the compiler turns these into plain loads and stores.
+	struct Writer {
+		uint8_t* p;
+
+		void u8(uint8_t v)		{ *p++ = v; }
+		void u16(uint16_t v)	{ u8((uint8_t)v); u8((uint8_t)(v >> 8)); }
+		void u32(uint32_t v)	{ u16((uint16_t)v); u16((uint16_t)(v >> 16)); }
+		void u64(uint64_t v)	{ u32((uint32_t)v); u32((uint32_t)(v >> 32)); }
+		void i32(int32_t v)		{ u32((uint32_t)v); }
+		void i64(int64_t v)		{ u64((uint64_t)v); }
+		void f64(double v)		{ uint64_t u; memcpy(&u, &v, 8); u64(u); }
+		void time(INSTimestamp::TimePoint t)	{ i64(t.time_since_epoch().count()); }
+		void status(INSStatus s)	{ u8((uint8_t)s); }
+	};
+
+	struct Reader {
+		const uint8_t* p;
+
+		uint8_t u8()		{ return *p++; }
+		uint16_t u16()		{ uint16_t v = u8(); return v | (uint16_t)(u8() << 8); }
+		uint32_t u32()		{ uint32_t v = u16(); return v | ((uint32_t)u16() << 16); }
+		uint64_t u64()		{ uint64_t v = u32(); return v | ((uint64_t)u32() << 32); }
+		int32_t i32()		{ return (int32_t)u32(); }
+		int64_t i64()		{ return (int64_t)u64(); }
+		double f64()		{ uint64_t u = u64(); double v; memcpy(&v, &u, 8); return v; }
+		INSTimestamp::TimePoint time()	{ return INSTimestamp::TimePoint(nanoseconds(i64())); }
+		INSStatus status()	{ return (INSStatus)u8(); }
+	};
+
+	void encode(Writer& w, const INSRecord& record){
+		w.u8((uint8_t)record.type);
+		switch (record.type){
+		case INSRecordType::AIPOV:{
+			const AIPOVRecord& r = record.aipov;
+			w.time(r.time);
+			w.f64(r.heading); w.f64(r.roll); w.f64(r.pitch);
+			w.f64(r.rotation_rate_xv1); w.f64(r.rotation_rate_xv2); w.f64(r.rotation_rate_xv3);
+			w.f64(r.linear_acceleration_xv1); w.f64(r.linear_acceleration_xv2); w.f64(r.linear_acceleration_xv3);
+			w.f64(r.latitude); w.f64(r.longitude); w.f64(r.altitude);
+			w.f64(r.north_velocity); w.f64(r.east_velocity); w.f64(r.vertical_velocity);
+			w.f64(r.along_velocity_xv1); w.f64(r.across_velocity_xv2); w.f64(r.down_velocity_xv3);
+			w.f64(r.true_course);
+			w.u32(r.user_status.bits);
+			break;
+		}
+		case INSRecordType::TECHSAS:{
+			const TECHSASRecord& r = record.techsas;
+			w.time(r.time);
+			w.f64(r.heading); w.f64(r.roll); w.f64(r.pitch); w.f64(r.heave);
+			w.f64(r.roll_standard_deviation); w.f64(r.pitch_standard_deviation); w.f64(r.heading_standard_deviation);
+			w.u8(r.true_heading); w.u8(r.x); w.u8(r.y);
+			break;
+		}
+		case INSRecordType::IXSEA_TAH:{
+			const IXSEA_TAHRecord& r = record.ixsea_tah;
+			w.time(r.time);
+			w.i32(r.protocol_version_id); w.i32(r.latency);
+			w.status(r.utc_time_status); w.status(r.true_heading_status); w.status(r.roll_status); w.status(r.pitch_status); w.status(r.heave_status);
+			w.f64(r.true_heading); w.f64(r.roll); w.f64(r.pitch);
+			w.f64(r.heave_no_lever_arms); w.f64(r.heave); w.f64(r.surge); w.f64(r.sway);
+			w.f64(r.heave_speed); w.f64(r.surge_speed); w.f64(r.sway_speed);
+			w.f64(r.heading_rate);
+			break;
+		}
+		case INSRecordType::ZDA:
+			w.time(record.zda.time);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void decode(Reader& in, INSRecord& record){
+		switch ((INSRecordType)in.u8()){
+		case INSRecordType::AIPOV:{
+			AIPOVRecord r;
+			r.time = in.time();
+			r.heading = in.f64(); r.roll = in.f64(); r.pitch = in.f64();
+			r.rotation_rate_xv1 = in.f64(); r.rotation_rate_xv2 = in.f64(); r.rotation_rate_xv3 = in.f64();
+			r.linear_acceleration_xv1 = in.f64(); r.linear_acceleration_xv2 = in.f64(); r.linear_acceleration_xv3 = in.f64();
+			r.latitude = in.f64(); r.longitude = in.f64(); r.altitude = in.f64();
+			r.north_velocity = in.f64(); r.east_velocity = in.f64(); r.vertical_velocity = in.f64();
+			r.along_velocity_xv1 = in.f64(); r.across_velocity_xv2 = in.f64(); r.down_velocity_xv3 = in.f64();
+			r.true_course = in.f64();
+			r.user_status.bits = in.u32();
+			record = INSRecord(r);
+			break;
+		}
+		case INSRecordType::TECHSAS:{
+			TECHSASRecord r;
+			r.time = in.time();
+			r.heading = in.f64(); r.roll = in.f64(); r.pitch = in.f64(); r.heave = in.f64();
+			r.roll_standard_deviation = in.f64(); r.pitch_standard_deviation = in.f64(); r.heading_standard_deviation = in.f64();
+			r.true_heading = in.u8(); r.x = in.u8(); r.y = in.u8();
+			record = INSRecord(r);
+			break;
+		}
+		case INSRecordType::IXSEA_TAH:{
+			IXSEA_TAHRecord r;
+			r.time = in.time();
+			r.protocol_version_id = in.i32(); r.latency = in.i32();
+			r.utc_time_status = in.status(); r.true_heading_status = in.status(); r.roll_status = in.status(); r.pitch_status = in.status(); r.heave_status = in.status();
+			r.true_heading = in.f64(); r.roll = in.f64(); r.pitch = in.f64();
+			r.heave_no_lever_arms = in.f64(); r.heave = in.f64(); r.surge = in.f64(); r.sway = in.f64();
+			r.heave_speed = in.f64(); r.surge_speed = in.f64(); r.sway_speed = in.f64();
+			r.heading_rate = in.f64();
+			record = INSRecord(r);
+			break;
+		}
+		case INSRecordType::ZDA:{
+			ZDARecord r;
+			r.time = in.time();
+			record = INSRecord(r);
+			break;
+		}
+		default:
+			record = INSRecord();
+			break;
+		}
+	}
+
+	void encodeFileHeader(uint8_t* header){
+		memset(header, 0, INSRecordLogFormat::FileHeaderSize);
+		Writer w{ header };
+		for (char c : FileMagic){
+			w.u8((uint8_t)c);
+		}
+		w.u16(INSRecordLogFormat::Version);
+		w.u16((uint16_t)INSRecordLogFormat::FileHeaderSize);
+		for (int type = 0; type < 8; type++){
+			w.u8((uint8_t)INSRecordLogFormat::recordSize((INSRecordType)type));
+		}
+		w.p = header + 28;
+		w.u32(crc32c(header, 28));
+	}
+
+	// Version of a header this code can read, 0 if it can't
+	uint16_t checkFileHeader(const uint8_t* header, size_t size){
+		if (size < INSRecordLogFormat::FileHeaderSize || memcmp(header, FileMagic, 8) != 0){
+			return 0;
+		}
+		Reader in{ header + 8 };
+		uint16_t version = in.u16();
+		uint16_t headerSize = in.u16();
+		if (version == 0 || version > INSRecordLogFormat::Version || headerSize != INSRecordLogFormat::FileHeaderSize){
+			return 0;
+		}
+		for (int type = 0; type < 8; type++){
+			if (in.u8() != INSRecordLogFormat::recordSize((INSRecordType)type)){
+				return 0;
+			}
+		}
+		in.p = header + 28;
+		if (in.u32() != crc32c(header, 28)){
+			return 0;
+		}
+		return version;
+	}
+
+}
+
+size_t INSRecordLogFormat::recordSize(INSRecordType type){
+	switch (type){
+	case INSRecordType::AIPOV:		return 1 + 8 + 19 * 8 + 4;
+	case INSRecordType::TECHSAS:	return 1 + 8 + 7 * 8 + 3;
+	case INSRecordType::IXSEA_TAH:	return 1 + 8 + 2 * 4 + 5 + 11 * 8;
+	case INSRecordType::ZDA:		return 1 + 8;
+	default:						return 0;
+	}
+}
+
+
+// ------------- WRITER -------------
+
+INSRecordLogWriter::INSRecordLogWriter()
+: fd(-1)
+, ok(false)
+, count(0)
+, records(0)
+, bytes(0)
+, blockSize(64 << 10)
+{ }
+
+INSRecordLogWriter::~INSRecordLogWriter() {
+	close();
+}
+
+bool INSRecordLogWriter::open(const string& path, bool append){
+	close();
+	records = 0;
+	bytes = 0;
+
+	struct stat info;
+	if (append && stat(path.c_str(), &info) == 0 && info.st_size > 0){
+		// after the last good block, a block torn by a crash is cut off
+		INSRecordLogReader reader;
+		if (!reader.open(path)){
+			errno = EINVAL;
+			return false;
+		}
+		if (reader.version() != INSRecordLogFormat::Version){
+			errno = EINVAL;		// would mix versions
+			return false;
+		}
+		uint64_t end = INSRecordLogFormat::FileHeaderSize;
+		INSRecordLogReader::Block b;
+		while (reader.nextBlock(b)){
+			end = b.offset + INSRecordLogFormat::BlockHeaderSize + b.size;
+		}
+		reader.close();
+
+		fd = ::open(path.c_str(), O_WRONLY);
+		if (fd < 0){
+			return false;
+		}
+		if (ftruncate(fd, (off_t)end) != 0 || lseek(fd, (off_t)end, SEEK_SET) < 0){
+			::close(fd);
+			fd = -1;
+			return false;
+		}
+		bytes = end;
+	}
+	else{
+		fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0){
+			return false;
+		}
+		uint8_t header[INSRecordLogFormat::FileHeaderSize];
+		encodeFileHeader(header);
+		if (!writeAll(header, sizeof(header))){
+			::close(fd);
+			fd = -1;
+			return false;
+		}
+	}
+
+	ok = true;
+	block.reserve(INSRecordLogFormat::BlockHeaderSize + blockSize + INSRecordLogFormat::recordSize(INSRecordType::AIPOV));
+	block.assign(INSRecordLogFormat::BlockHeaderSize, 0);
+	count = 0;
+	return true;
+}
+
+bool INSRecordLogWriter::writeAll(const uint8_t* data, size_t size){
+	while (size > 0){
+		ssize_t written = ::write(fd, data, size);
+		if (written < 0){
+			if (errno == EINTR){
+				continue;
+			}
+			ok = false;
+			return false;
+		}
+		data += written;
+		size -= (size_t)written;
+		bytes += (uint64_t)written;
+	}
+	return true;
+}
+
+void INSRecordLogWriter::push(const INSRecord& record){
+	size_t size = INSRecordLogFormat::recordSize(record.type);
+	if (fd < 0 || size == 0){
+		return;
+	}
+
+	size_t at = block.size();
+	block.resize(at + size);
+	Writer w{ block.data() + at };
+	encode(w, record);
+
+	// time of the first record and latest time in the block header
+	if (count == 0 || record.time() > latest){
+		latest = record.time();
+	}
+	w.p = block.data() + (count == 0 ? 16 : 24);
+	if (count == 0){
+		w.time(record.time());
+	}
+	w.time(latest);
+	count++;
+	records++;
+
+	if (block.size() - INSRecordLogFormat::BlockHeaderSize >= blockSize){
+		flush();
+	}
+}
+
+bool INSRecordLogWriter::flush(){
+	if (fd < 0 || count == 0){
+		return ok;
+	}
+	Writer w{ block.data() };
+	w.u32(INSRecordLogFormat::BlockMagic);
+	w.u32(0);
+	w.u32((uint32_t)(block.size() - INSRecordLogFormat::BlockHeaderSize));
+	w.u32(count);
+	w.p = block.data() + 4;
+	w.u32(crc32c(block.data() + 8, block.size() - 8));
+
+	if (ok){
+		writeAll(block.data(), block.size());
+	}
+	block.resize(INSRecordLogFormat::BlockHeaderSize);
+	count = 0;
+	return ok;
+}
+
+bool INSRecordLogWriter::close(){
+	if (fd < 0){
+		return ok;
+	}
+	flush();
+	if (::close(fd) != 0){
+		ok = false;
+	}
+	fd = -1;
+	return ok;
+}
+
+bool INSRecordLogWriter::good() const {
+	return ok;
+}
+
+uint64_t INSRecordLogWriter::recordCount() const {
+	return records;
+}
+
+uint64_t INSRecordLogWriter::bytesWritten() const {
+	return bytes;
+}
+
+
+// ------------- READER -------------
+
+INSRecordLogReader::INSRecordLogReader()
+: fileVersion(0)
+, following(INSRecordLogFormat::FileHeaderSize)
+, current()
+, position(0)
+, left(0)
+, bad(0)
+{ }
+
+INSRecordLogReader::~INSRecordLogReader()
+{ }
+
+bool INSRecordLogReader::open(const string& path){
+	close();
+	if (!file.open(path)){
+		return false;
+	}
+	fileVersion = checkFileHeader(file.data(), file.size());
+	if (fileVersion == 0){
+		file.close();
+		errno = EINVAL;
+		return false;
+	}
+	file.advise(MappedFile::Access::Sequential);
+	rewind();
+	return true;
+}
+
+void INSRecordLogReader::close(){
+	file.close();
+	fileVersion = 0;
+	rewind();
+}
+
+uint16_t INSRecordLogReader::version() const {
+	return fileVersion;
+}
+
+void INSRecordLogReader::rewind(){
+	following = INSRecordLogFormat::FileHeaderSize;
+	left = 0;
+	bad = 0;
+}
+
+bool INSRecordLogReader::readBlock(uint64_t offset, Block& block) const {
+	const uint64_t headerSize = INSRecordLogFormat::BlockHeaderSize;
+	if (offset < INSRecordLogFormat::FileHeaderSize || offset + headerSize > file.size()){
+		return false;
+	}
+	Reader in{ file.data() + offset };
+	if (in.u32() != INSRecordLogFormat::BlockMagic){
+		return false;
+	}
+	uint32_t crc = in.u32();
+	block.offset = offset;
+	block.size = in.u32();
+	block.count = in.u32();
+	block.first = in.time();
+	block.latest = in.time();
+	if (block.size > file.size() - offset - headerSize){
+		return false;		// cut off
+	}
+	return crc32c(file.data() + offset + 8, headerSize - 8 + block.size) == crc;
+}
+
+bool INSRecordLogReader::nextBlock(Block& block){
+	bool damaged = false;
+	while (following + INSRecordLogFormat::BlockHeaderSize <= file.size()){
+		if (readBlock(following, block)){
+			current = block;
+			position = block.offset + INSRecordLogFormat::BlockHeaderSize;
+			left = block.count;
+			following = position + block.size;
+			return true;
+		}
+		if (!damaged){
+			bad++;
+			damaged = true;
+		}
+
+		// look for the next block
+		const uint8_t* start = file.data() + following + 1;
+		const uint8_t* end = file.data() + file.size();
+		const uint8_t magic[4] = { 'I', 'B', 'L', 'K' };
+		const uint8_t* found = static_cast<const uint8_t*>(memmem(start, end - start, magic, 4));
+		following = (found != nullptr) ? (uint64_t)(found - file.data()) : file.size();
+	}
+	left = 0;
+	return false;
+}
+
+bool INSRecordLogReader::seekBlock(uint64_t offset){
+	Block block;
+	if (!readBlock(offset, block)){
+		return false;
+	}
+	current = block;
+	position = block.offset + INSRecordLogFormat::BlockHeaderSize;
+	left = block.count;
+	following = position + block.size;
+	return true;
+}
+
+bool INSRecordLogReader::seek(INSTimestamp::TimePoint time){
+	return seekFrom(INSRecordLogFormat::FileHeaderSize, time);
+}
+
+bool INSRecordLogReader::seek(INSTimestamp::TimePoint time, const INSTimeIndex& index){
+	INSTimeIndex::Entry entry;
+	if (index.sourceType() != INSTimeIndex::Source::RecordLog || index.sourceSize() > file.size() || !index.find(time, entry)){
+		return seek(time);
+	}
+	// a block of this log must start at the entry, with the entry's time, else the index
+	// is of another log or of this one before it was rewritten
+	Block block;
+	if (!readBlock(entry.offset, block) || block.first != entry.time){
+		return seek(time);
+	}
+	return seekFrom(entry.offset, time);
+}
+
+bool INSRecordLogReader::seekFrom(uint64_t offset, INSTimestamp::TimePoint time){
+	following = offset;
+	left = 0;
+	Block block;
+	while (nextBlock(block)){
+		if (block.latest < time){
+			continue;
+		}
+		// the time of a record is right after its type byte
+		while (left > 0){
+			size_t size = INSRecordLogFormat::recordSize((INSRecordType)file.data()[position]);
+			if (size == 0){
+				break;
+			}
+			Reader in{ file.data() + position + 1 };
+			if (in.time() >= time){
+				return true;
+			}
+			position += size;
+			left--;
+		}
+	}
+	return false;
+}
+
+bool INSRecordLogReader::next(INSRecord& record){
+	while (true){
+		if (left > 0){
+			uint64_t end = current.offset + INSRecordLogFormat::BlockHeaderSize + current.size;
+			size_t size = INSRecordLogFormat::recordSize((INSRecordType)file.data()[position]);
+			if (size != 0 && position + size <= end){
+				Reader in{ file.data() + position };
+				decode(in, record);
+				position += size;
+				left--;
+				return true;
+			}
+			left = 0;		// the CRC matched but not the records, written by something else
+		}
+		Block block;
+		if (!nextBlock(block)){
+			return false;
+		}
+	}
+}
+
+size_t INSRecordLogReader::read(INSRecord* records, size_t count){
+	size_t n = 0;
+	while (n < count && next(records[n])){
+		n++;
+	}
+	return n;
+}
+
+uint64_t INSRecordLogReader::size() const {
+	return file.size();
+}
+
+uint64_t INSRecordLogReader::badBlocks() const {
+	return bad;
+}
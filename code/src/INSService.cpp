@@ -18,9 +18,92 @@ using namespace std::chrono;
 using namespace nmea;
 
 
+// ------------- PARAMETER READER -------------
+
+// Reads the parameters of a sentence in order and stops at the first one that is not a number.
+// The fix is only written with values that did parse.
+class ParameterReader {
+private:
+	const NMEASentence& nmea;
+	const char* context;
+public:
+	NMEAParseResult result;
+
+	ParameterReader(const NMEASentence& n, const char* ctx)
+		: nmea(n), context(ctx)
+	{}
+
+	bool number(size_t i, double& value){
+		double d;
+		if (result && !tryParseDouble(nmea.parameters[i], d)){
+			result = NMEAParseResult(NMEAParseStatus::BadNumber, (uint32_t)(nmea.parameters[i].data() - nmea.text.data()), context);
+		}
+		if (result){
+			value = d;
+		}
+		return result.ok();
+	}
+
+	// Decodes hhmmss.sss straight from the characters, other shapes go through the number.
+	bool time(size_t i, INSTimestamp& timestamp){
+		if (result && timestamp.setTime(nmea.parameters[i])){
+			return true;
+		}
+		double d;
+		if (number(i, d)){
+			timestamp.setTime(d);
+		}
+		return result.ok();
+	}
+
+	// 0/1 flags are read as is, other numbers are true when not 0 like before
+	bool flag(size_t i, bool& value){
+		string_view p = nmea.parameters[i];
+		if (result && p.size() == 1 && (p[0] == '0' || p[0] == '1')){
+			value = p[0] == '1';
+			return true;
+		}
+		double d;
+		if (number(i, d)){
+			value = d;
+		}
+		return result.ok();
+	}
+
+	bool integer(size_t i, int& value){
+		int64_t d;
+		if (result && !tryParseInt(nmea.parameters[i], d)){
+			result = NMEAParseResult(NMEAParseStatus::BadNumber, (uint32_t)(nmea.parameters[i].data() - nmea.text.data()), context);
+		}
+		if (result){
+			value = (int)d;
+		}
+		return result.ok();
+	}
+};
+
+// Checks shared by the readers, before any parameter is read.
+static NMEAParseResult checkSentence(const NMEASentence& nmea, size_t parameters, const char* context){
+	if (!nmea.checksumOK()){
+		uint32_t offset = nmea.checksumIsCalculated ? (uint32_t)(nmea.checksum.data() - nmea.text.data()) : (uint32_t)nmea.text.size();
+		return NMEAParseResult(NMEAParseStatus::ChecksumMismatch, offset, context);
+	}
+	if (nmea.parameters.size() < parameters){
+		return NMEAParseResult(NMEAParseStatus::MissingParameters, (uint32_t)nmea.text.size(), context);
+	}
+	return NMEAParseResult();
+}
+
+
 // ------------- INSSERVICE CLASS -------------
 
-INSService::INSService(NMEAParser& parser) {
+INSService::INSService()
+: badZDACount(0)
+{ }
+
+INSService::INSService(NMEAParser& parser)
+: badZDACount(0)
+{
 	attachToParser(parser);		// attach to parser in the INS object
 }
 
@@ -28,22 +111,59 @@ INSService::~INSService() {
 	// TODO Auto-generated destructor stub
 }
 
-void INSService::attachToParser(NMEAParser& _parser){
+void INSService::publishTo(std::nullptr_t){
+	sink = nullptr;
+}
+
+NMEAParseResult INSService::publish(const NMEAParseResult& result){
+	latest.store(fix);
+	return result;
+}
+
+INSFix INSService::snapshot() const {
+	return latest.load();
+}
 
-	_parser.setSentenceHandler("AIPOV", [this](const NMEASentence& nmea){
-		this->read_AIPOV(nmea);
+uint64_t INSService::snapshotVersion() const {
+	return latest.version();
+}
+
+template <class Current>
+void INSService::attach(NMEAParser& _parser, Current current){
+
+	_parser.setSentenceReader("AIPOV", [current](const NMEASentence& nmea){
+		INSService* service = current();
+		return service->publish(service->read_AIPOV(nmea));
+	});
+	_parser.setSentenceReader("PASHR", [current](const NMEASentence& nmea){
+		INSService* service = current();
+		return service->publish(service->read_TECHSAS(nmea));
+	});
+	_parser.setSentenceReader("PHOCT", [current](const NMEASentence& nmea){
+		INSService* service = current();
+		return service->publish(service->read_IXSEA_TAH(nmea));
 	});
-	_parser.setSentenceHandler("PASHR", [this](const NMEASentence& nmea){
-		this->read_TECHSAS(nmea);
+	_parser.setSentenceReader("GPZDA", [current](const NMEASentence& nmea){
+		INSService* service = current();
+		return service->publish(service->read_ZDA(nmea));
 	});
-	_parser.setSentenceHandler("PHOCT", [this](const NMEASentence& nmea){
-		this->read_IXSEA_TAH(nmea);
+	_parser.setSentenceReader("INZDA", [current](const NMEASentence& nmea){
+		INSService* service = current();
+		return service->publish(service->read_ZDA(nmea));
 	});
 
 }
 
+void INSService::attachToParser(NMEAParser& _parser){
+	attach(_parser, [this]{ return this; });
+}
+
+void INSService::attachToParser(NMEAParser& _parser, INSService* (*current)()){
+	attach(_parser, current);
+}
+
 
-void INSService::read_AIPOV(const NMEASentence& nmea){
+NMEAParseResult INSService::read_AIPOV(const NMEASentence& nmea){
 	
 	/*
 	AIPOV Sentence see p.171
@@ -77,65 +197,92 @@ void INSService::read_AIPOV(const NMEASentence& nmea){
 	[20]      hh          : Checksum                    hex
 	*/
 	
-	try
-	{
-		
-		if (!nmea.checksumOK()){
-			throw NMEAParseError("Checksum is invalid!");
-		}
-		
-		if (nmea.parameters.size() < 21){
-			throw NMEAParseError("INS data is missing parameters.");
-		}
-		
-		this->fix.timestamp.setTime(parseDouble(nmea.parameters[0]));
-		
-		this->fix.heading = parseDouble(nmea.parameters[1]);
-		this->fix.roll = parseDouble(nmea.parameters[2]);
-		this->fix.pitch = parseDouble(nmea.parameters[3]);
+	NMEAParseResult result = checkSentence(nmea, 21, "INS Data Bad Format [$AIPOV]");
+	if (!result){
+		return result;
+	}
 
-		this->fix.rotation_rate_xv1 = parseDouble(nmea.parameters[4]);
-		this->fix.rotation_rate_xv2 = parseDouble(nmea.parameters[5]);
-		this->fix.rotation_rate_xv3 = parseDouble(nmea.parameters[6]);
+	ParameterReader read(nmea, "INS Number Bad Format [$AIPOV]");
 
-		this->fix.linear_acceleration_xv1 = parseDouble(nmea.parameters[7]);
-		this->fix.linear_acceleration_xv2 = parseDouble(nmea.parameters[8]);
-		this->fix.linear_acceleration_xv3 = parseDouble(nmea.parameters[9]);
+	if (read.time(0, this->fix.timestamp)){
+		this->date.track(this->fix.timestamp);
+	}
+	
+	read.number(1, this->fix.heading);
+	read.number(2, this->fix.roll);
+	read.number(3, this->fix.pitch);
 
-		this->fix.latitude = parseDouble(nmea.parameters[10]);
-		this->fix.longitude = parseDouble(nmea.parameters[11]);
-		this->fix.altitude = parseDouble(nmea.parameters[12]);
+	read.number(4, this->fix.rotation_rate_xv1);
+	read.number(5, this->fix.rotation_rate_xv2);
+	read.number(6, this->fix.rotation_rate_xv3);
 
-		this->fix.north_velocity = parseDouble(nmea.parameters[13]);
-		this->fix.east_velocity = parseDouble(nmea.parameters[14]);
-		this->fix.vertical_velocity = parseDouble(nmea.parameters[15]);
+	read.number(7, this->fix.linear_acceleration_xv1);
+	read.number(8, this->fix.linear_acceleration_xv2);
+	read.number(9, this->fix.linear_acceleration_xv3);
 
-		this->fix.along_velocity_xv1 = parseDouble(nmea.parameters[16]);
-		this->fix.across_velocity_xv2 = parseDouble(nmea.parameters[17]);
-		this->fix.down_velocity_xv3 = parseDouble(nmea.parameters[18]);
+	read.number(10, this->fix.latitude);
+	read.number(11, this->fix.longitude);
+	read.number(12, this->fix.altitude);
 
-		this->fix.true_course = parseDouble(nmea.parameters[19]);
+	read.number(13, this->fix.north_velocity);
+	read.number(14, this->fix.east_velocity);
+	read.number(15, this->fix.vertical_velocity);
 
-		this->fix.user_status = nmea.parameters[20];
+	read.number(16, this->fix.along_velocity_xv1);
+	read.number(17, this->fix.across_velocity_xv2);
+	read.number(18, this->fix.down_velocity_xv3);
 
+	if (read.number(19, this->fix.true_course)){
+		this->fix.user_status = parseINSUserStatus(nmea.parameters[20]);
 	}
 
-	catch (NumberConversionError& ex)
-	{
-		NMEAParseError pe("INS Number Bad Format [$AIPOV] :: " + ex.message, nmea);
-		throw pe;
+	if (read.result && (!onAIPOV.empty() || sink)){
+		AIPOVRecord record;
+		record.time = fix.timestamp.timePoint();
+		record.heading = fix.heading;
+		record.roll = fix.roll;
+		record.pitch = fix.pitch;
+		record.rotation_rate_xv1 = fix.rotation_rate_xv1;
+		record.rotation_rate_xv2 = fix.rotation_rate_xv2;
+		record.rotation_rate_xv3 = fix.rotation_rate_xv3;
+		record.linear_acceleration_xv1 = fix.linear_acceleration_xv1;
+		record.linear_acceleration_xv2 = fix.linear_acceleration_xv2;
+		record.linear_acceleration_xv3 = fix.linear_acceleration_xv3;
+		record.latitude = fix.latitude;
+		record.longitude = fix.longitude;
+		record.altitude = fix.altitude;
+		record.north_velocity = fix.north_velocity;
+		record.east_velocity = fix.east_velocity;
+		record.vertical_velocity = fix.vertical_velocity;
+		record.along_velocity_xv1 = fix.along_velocity_xv1;
+		record.across_velocity_xv2 = fix.across_velocity_xv2;
+		record.down_velocity_xv3 = fix.down_velocity_xv3;
+		record.true_course = fix.true_course;
+		record.user_status = fix.user_status;
+		onAIPOV(record);
+		if (sink){
+			sink(INSRecord(record));
+		}
 	}
 
-	catch (NMEAParseError& ex)
-	{
-		NMEAParseError pe("INS Data Bad Format [$AIPOV] :: " + ex.message, nmea);
-		throw pe;
+	if (read.result && history.capacity() > 0){
+		INSPose pose;
+		pose.time = fix.timestamp.timePoint();
+		pose.latitude = fix.latitude;
+		pose.longitude = fix.longitude;
+		pose.altitude = fix.altitude;
+		pose.heading = fix.heading;
+		pose.roll = fix.roll;
+		pose.pitch = fix.pitch;
+		history.push(pose);
 	}
 
+	return read.result;
+
 }
 
 
-void INSService::read_TECHSAS(const NMEASentence& nmea){
+NMEAParseResult INSService::read_TECHSAS(const NMEASentence& nmea){
 	
 	/*
 	TECHSAS Sentence see p.247
@@ -158,52 +305,57 @@ void INSService::read_TECHSAS(const NMEASentence& nmea){
 	[10]      hh          : Checksum                    hex
 	*/
 	
-	try
-	{
-		
-		if (!nmea.checksumOK()){
-			throw NMEAParseError("Checksum is invalid!");
-		}
-		
-		if (nmea.parameters.size() < 11){
-			throw NMEAParseError("INS data is missing parameters.");
-		}
-		
-		this->fix.timestamp.setTime(parseDouble(nmea.parameters[0]));
-		
-		this->fix.heading = parseDouble(nmea.parameters[1]);
-
-		this->fix.T = nmea.parameters[2];
-
-		this->fix.roll = parseDouble(nmea.parameters[3]);
-		this->fix.pitch = parseDouble(nmea.parameters[4]);
-		this->fix.heave = parseDouble(nmea.parameters[5]);
-
-		this->fix.roll_standard_deviation = parseDouble(nmea.parameters[6]);
-		this->fix.pitch_standard_deviation = parseDouble(nmea.parameters[7]);
-		this->fix.heading_standard_deviation = parseDouble(nmea.parameters[8]);
-
-		this->fix.x = parseDouble(nmea.parameters[9]);
-		this->fix.y = parseDouble(nmea.parameters[10]);
-
+	NMEAParseResult result = checkSentence(nmea, 11, "INS Data Bad Format [$PASHR]");
+	if (!result){
+		return result;
 	}
 
-	catch (NumberConversionError& ex)
-	{
-		NMEAParseError pe("INS Number Bad Format [$PASHR] :: " + ex.message, nmea);
-		throw pe;
+	ParameterReader read(nmea, "INS Number Bad Format [$PASHR]");
+
+	if (read.time(0, this->fix.timestamp)){
+		this->date.track(this->fix.timestamp);
 	}
 	
-	catch (NMEAParseError& ex)
-	{
-		NMEAParseError pe("INS Data Bad Format [$PASHR] :: " + ex.message, nmea);
-		throw pe;
+	if (read.number(1, this->fix.heading)){
+		this->fix.T = nmea.parameters[2] == "T";
 	}
 
+	read.number(3, this->fix.roll);
+	read.number(4, this->fix.pitch);
+	read.number(5, this->fix.heave);
+
+	read.number(6, this->fix.roll_standard_deviation);
+	read.number(7, this->fix.pitch_standard_deviation);
+	read.number(8, this->fix.heading_standard_deviation);
+
+	read.flag(9, this->fix.x);
+	read.flag(10, this->fix.y);
+
+	if (read.result && (!onTECHSAS.empty() || sink)){
+		TECHSASRecord record;
+		record.time = fix.timestamp.timePoint();
+		record.heading = fix.heading;
+		record.roll = fix.roll;
+		record.pitch = fix.pitch;
+		record.heave = fix.heave;
+		record.roll_standard_deviation = fix.roll_standard_deviation;
+		record.pitch_standard_deviation = fix.pitch_standard_deviation;
+		record.heading_standard_deviation = fix.heading_standard_deviation;
+		record.true_heading = fix.T;
+		record.x = fix.x;
+		record.y = fix.y;
+		onTECHSAS(record);
+		if (sink){
+			sink(INSRecord(record));
+		}
+	}
+
+	return read.result;
+
 }
 
 
-void INSService::read_IXSEA_TAH(const NMEASentence& nmea){
+NMEAParseResult INSService::read_IXSEA_TAH(const NMEASentence& nmea){
 	
 	/*
 	IXSEA TAH Sentence see p.201
@@ -235,64 +387,133 @@ void INSService::read_IXSEA_TAH(const NMEASentence& nmea){
 	[18]      hh          : Checksum                   hex
 	*/
 	
-	try
-	{
-		
-		if (!nmea.checksumOK()){
-			throw NMEAParseError("Checksum is invalid!");
-		}
-		
-		if (nmea.parameters.size() < 19){
-			throw NMEAParseError("INS data is missing parameters.");
-		}
-		
-		this->fix.protocol_version_id = parseDouble(nmea.parameters[0]);
-
-		this->fix.timestamp.setTime(parseDouble(nmea.parameters[1]));
-		
-		this->fix.utc_time_status = nmea.parameters[2];
-
-		this->fix.latency = parseInt(nmea.parameters[3]);
-
-		this->fix.true_heading = parseDouble(nmea.parameters[4]);
-		this->fix.true_heading_status = nmea.parameters[5];
+	NMEAParseResult result = checkSentence(nmea, 19, "INS Data Bad Format [$IXSEA_TAH]");
+	if (!result){
+		return result;
+	}
 
-		this->fix.roll = parseDouble(nmea.parameters[6]);
-		this->fix.roll_status = nmea.parameters[7];
+	ParameterReader read(nmea, "INS Number Bad Format [$IXSEA_TAH]");
 
-		this->fix.pitch = parseDouble(nmea.parameters[8]);
-		this->fix.pitch_status = nmea.parameters[9];
+	double version;
+	if (read.number(0, version)){
+		this->fix.protocol_version_id = version;
+	}
 
-		this->fix.heave_no_lever_arms = parseDouble(nmea.parameters[10]);
-		this->fix.heave_status = nmea.parameters[11];
-		
-		this->fix.heave = parseDouble(nmea.parameters[12]);
-		this->fix.surge = parseDouble(nmea.parameters[13]);
-		this->fix.sway = parseDouble(nmea.parameters[14]);
+	if (read.time(1, this->fix.timestamp)){
+		this->date.track(this->fix.timestamp);
+		this->fix.utc_time_status = parseINSStatus(nmea.parameters[2]);
+	}
 
-		this->fix.heave_speed = parseDouble(nmea.parameters[15]);
-		this->fix.surge_speed = parseDouble(nmea.parameters[16]);
-		this->fix.sway_speed = parseDouble(nmea.parameters[17]);
+	read.integer(3, this->fix.latency);
 
-		this->fix.heading_rate = parseDouble(nmea.parameters[18]);
+	if (read.number(4, this->fix.true_heading)){
+		this->fix.true_heading_status = parseINSStatus(nmea.parameters[5]);
+	}
 
+	if (read.number(6, this->fix.roll)){
+		this->fix.roll_status = parseINSStatus(nmea.parameters[7]);
 	}
 
-	catch (NumberConversionError& ex)
-	{
-		NMEAParseError pe("INS Number Bad Format [$IXSEA_TAH] :: " + ex.message, nmea);
-		throw pe;
+	if (read.number(8, this->fix.pitch)){
+		this->fix.pitch_status = parseINSStatus(nmea.parameters[9]);
 	}
 
-	catch (NMEAParseError& ex)
-	{
-		NMEAParseError pe("INS Data Bad Format [$IXSEA_TAH] :: " + ex.message, nmea);
-		throw pe;
+	if (read.number(10, this->fix.heave_no_lever_arms)){
+		this->fix.heave_status = parseINSStatus(nmea.parameters[11]);
+	}
+	
+	read.number(12, this->fix.heave);
+	read.number(13, this->fix.surge);
+	read.number(14, this->fix.sway);
+
+	read.number(15, this->fix.heave_speed);
+	read.number(16, this->fix.surge_speed);
+	read.number(17, this->fix.sway_speed);
+
+	read.number(18, this->fix.heading_rate);
+
+	if (read.result && (!onIXSEA_TAH.empty() || sink)){
+		IXSEA_TAHRecord record;
+		record.time = fix.timestamp.timePoint();
+		record.protocol_version_id = fix.protocol_version_id;
+		record.latency = fix.latency;
+		record.utc_time_status = fix.utc_time_status;
+		record.true_heading_status = fix.true_heading_status;
+		record.roll_status = fix.roll_status;
+		record.pitch_status = fix.pitch_status;
+		record.heave_status = fix.heave_status;
+		record.true_heading = fix.true_heading;
+		record.roll = fix.roll;
+		record.pitch = fix.pitch;
+		record.heave_no_lever_arms = fix.heave_no_lever_arms;
+		record.heave = fix.heave;
+		record.surge = fix.surge;
+		record.sway = fix.sway;
+		record.heave_speed = fix.heave_speed;
+		record.surge_speed = fix.surge_speed;
+		record.sway_speed = fix.sway_speed;
+		record.heading_rate = fix.heading_rate;
+		onIXSEA_TAH(record);
+		if (sink){
+			sink(INSRecord(record));
+		}
 	}
 
+	return read.result;
+
 }
 
 
+NMEAParseResult INSService::read_ZDA(const NMEASentence& nmea){
 
+	/*
+	ZDA Sentence
+    Sentence format is:
+    $--ZDA,hhmmss.ss,dd,mm,yyyy,xx,yy*hh<CR><LF>
 
+	| Index |   Format    | Parameter name           | Unit            | Range          | More Info                        |
+	|-------|-------------|--------------------------|-----------------|----------------|----------------------------------|
+	[ 0]      hhmmss.ss   : UTC Time
+	[ 1]      dd          : Day                                          01-31
+	[ 2]      mm          : Month                                        01-12
+	[ 3]      yyyy        : Year
+	[ 4]      xx          : Local Zone Hours                             +/-13            not used
+	[ 5]      yy          : Local Zone Minutes                           00-59            not used
+	[ 5]      hh          : Checksum                   hex
+	*/
 
+	// A ZDA only dates the fixes, one that can't be read is counted and skipped rather
+	// than failing a stream that was read without them before.
+	if (!checkSentence(nmea, 4, "INS Data Bad Format [$ZDA]")){
+		this->badZDACount++;
+		return NMEAParseResult();
+	}
+
+	ParameterReader read(nmea, "INS Number Bad Format [$ZDA]");
+
+	INSTimestamp timestamp = this->fix.timestamp;
+	int day, month, year;
+	read.time(0, timestamp);
+	read.integer(1, day);
+	read.integer(2, month);
+	read.integer(3, year);
+	if (!read.result){
+		this->badZDACount++;
+		return NMEAParseResult();
+	}
+
+	this->date.setDate(year, month, day);
+	this->date.track(timestamp);
+
+	if (!onZDA.empty() || sink){
+		ZDARecord record;
+		record.time = timestamp.timePoint();
+		onZDA(record);
+		if (sink){
+			sink(INSRecord(record));
+		}
+	}
+
+	return read.result;
+
+}
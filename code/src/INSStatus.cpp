@@ -0,0 +1,74 @@
+#include <nmeaparse/INSStatus.h>
+#include <nmeaparse/NumberConversion.h>
+
+using namespace std;
+
+using namespace nmea;
+
+
+INSStatus nmea::parseINSStatus(string_view s){
+	if (s.size() != 1){
+		return INSStatus::Unknown;
+	}
+	switch (s[0]){
+	case 'T':	return INSStatus::Valid;
+	case 'E':	return INSStatus::Invalid;
+	case 'I':	return INSStatus::Initializing;
+	default:	return INSStatus::Unknown;
+	}
+}
+
+char nmea::toChar(INSStatus status){
+	switch (status){
+	case INSStatus::Valid:			return 'T';
+	case INSStatus::Invalid:		return 'E';
+	case INSStatus::Initializing:	return 'I';
+	default:						return '?';
+	}
+}
+
+INSUserStatus nmea::parseINSUserStatus(string_view s){
+	int64_t bits;
+	if (!tryParseInt(s, bits, 16)){
+		bits = 0;
+	}
+	return INSUserStatus{ (uint32_t)bits };
+}
+
+const char* INSUserStatus::name(Bit bit){
+	switch (bit){
+	case DVL_RECEIVED_VALID:		return "DVL_RECEIVED_VALID";
+	case GPS_RECEIVED_VALID:		return "GPS_RECEIVED_VALID";
+	case DEPTH_RECEIVED_VALID:		return "DEPTH_RECEIVED_VALID";
+	case USBL_RECEIVED_VALID:		return "USBL_RECEIVED_VALID";
+	case LBL_RECEIVED_VALID:		return "LBL_RECEIVED_VALID";
+	case GPS2_RECEIVED_VALID:		return "GPS2_RECEIVED_VALID";
+	case EMLOG_RECEIVED_VALID:		return "EMLOG_RECEIVED_VALID";
+	case MANUAL_GPS_RECEIVED_VALID:	return "MANUAL_GPS_RECEIVED_VALID";
+	case TIME_RECEIVED_VALID:		return "TIME_RECEIVED_VALID";
+	case FOG_ANOMALY:				return "FOG_ANOMALY";
+	case ACC_ANOMALY:				return "ACC_ANOMALY";
+	case TEMPERATURE_ERR:			return "TEMPERATURE_ERR";
+	case CPU_OVERLOAD:				return "CPU_OVERLOAD";
+	case DYNAMIC_EXCEEDED:			return "DYNAMIC_EXCEEDED";
+	case SPEED_SATURATION:			return "SPEED_SATURATION";
+	case ALTITUDE_SATURATION:		return "ALTITUDE_SATURATION";
+	case INPUT_A_ERR:				return "INPUT_A_ERR";
+	case INPUT_B_ERR:				return "INPUT_B_ERR";
+	case INPUT_C_ERR:				return "INPUT_C_ERR";
+	case INPUT_D_ERR:				return "INPUT_D_ERR";
+	case INPUT_E_ERR:				return "INPUT_E_ERR";
+	case OUTPUT_A_ERR:				return "OUTPUT_A_ERR";
+	case OUTPUT_B_ERR:				return "OUTPUT_B_ERR";
+	case OUTPUT_C_ERR:				return "OUTPUT_C_ERR";
+	case OUTPUT_D_ERR:				return "OUTPUT_D_ERR";
+	case OUTPUT_E_ERR:				return "OUTPUT_E_ERR";
+	case HRP_INVALID:				return "HRP_INVALID";
+	case ALIGNMENT:					return "ALIGNMENT";
+	case FINE_ALIGNMENT:			return "FINE_ALIGNMENT";
+	case NAVIGATION:				return "NAVIGATION";
+	case DEGRADED_MODE:				return "DEGRADED_MODE";
+	case FAILURE_MODE:				return "FAILURE_MODE";
+	}
+	return "UNKNOWN";
+}
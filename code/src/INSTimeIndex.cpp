@@ -0,0 +1,270 @@
+#include <nmeaparse/INSTimeIndex.h>
+#include <nmeaparse/INSRecordLog.h>
+#include <nmeaparse/INSService.h>
+#include <nmeaparse/NMEAParser.h>
+#include <nmeaparse/SIMDKernels.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+// ------------- FILE -------------
+
+// "INSTIDX" and a 0, version, source, stride, size of the source, entry count, the
+// entries (time, offset, earliest) and the CRC-32C of all that, little endian.
+static const char IndexMagic[8] = { 'I', 'N', 'S', 'T', 'I', 'D', 'X', 0 };
+static const uint16_t IndexVersion = 2;
+static const size_t IndexHeaderSize = 40;
+static const size_t IndexEntrySize = 24;
+
+static void put(vector<uint8_t>& out, uint64_t v, int bytes){
+	for (int i = 0; i < bytes; i++){
+		out.push_back((uint8_t)(v >> (8 * i)));
+	}
+}
+
+static uint64_t get(const uint8_t* p, int bytes){
+	uint64_t v = 0;
+	for (int i = 0; i < bytes; i++){
+		v |= (uint64_t)p[i] << (8 * i);
+	}
+	return v;
+}
+
+
+// ------------- TIME INDEX -------------
+
+int64_t INSTimeIndex::Entry::day() const {
+	int64_t ns = time.time_since_epoch().count();
+	const int64_t day = 86400LL * 1000000000LL;
+	return (ns >= 0) ? ns / day : -((-ns + day - 1) / day);
+}
+
+INSTimeIndex::INSTimeIndex()
+: interval(0)
+, size(0)
+, source(Source::None)
+{ }
+
+INSTimeIndex::~INSTimeIndex()
+{ }
+
+bool INSTimeIndex::add(INSTimestamp::TimePoint time, uint64_t offset){
+	if (entries.empty() || time >= entries.back().time + interval){
+		entries.push_back(Entry{ time, offset, INSTimestamp::TimePoint::min() });
+		return true;
+	}
+	return false;
+}
+
+void INSTimeIndex::setEarliest(){
+	INSTimestamp::TimePoint earliest = INSTimestamp::TimePoint::max();
+	for (auto it = entries.rbegin(); it != entries.rend(); ++it){
+		earliest = min(earliest, it->earliest);
+		it->earliest = earliest;
+	}
+}
+
+void INSTimeIndex::buildFromText(const MappedFile& file, nanoseconds stride, const INSDateTracker& start){
+	entries.clear();
+	interval = stride;
+	size = file.size();
+	source = Source::Text;
+
+	// first record of every line, lines are fed one by one to know where each one starts
+	struct FirstTime {
+		bool seen;
+		INSTimestamp::TimePoint time;
+		INSTimestamp::TimePoint earliest;	// of the line
+		INSTimestamp::TimePoint latest;		// of all the records so far
+
+		void push(const INSRecord& record){
+			if (!seen){
+				seen = true;
+				time = record.time();
+				earliest = time;
+			}
+			earliest = min(earliest, record.time());
+			latest = max(latest, record.time());
+		}
+	} first;
+	first.latest = INSTimestamp::TimePoint::min();
+	INSTimestamp::TimePoint span = INSTimestamp::TimePoint::max();		// earliest since the last entry
+
+	NMEAParser parser;
+	parser.prefilter = true;
+	INSService service(parser);
+	service.date = start;
+	service.date.journal = nullptr;
+	service.publishTo(first);
+
+	file.advise(MappedFile::Access::Sequential);
+	const uint8_t* data = file.data();
+	uint64_t position = 0;
+	while (position < size){
+		const uint8_t* newline = static_cast<const uint8_t*>(memchr(data + position, '\n', size - position));
+		uint64_t end = (newline != nullptr) ? (uint64_t)(newline + 1 - data) : size;
+
+		first.seen = false;
+		INSTimestamp::TimePoint before = first.latest;
+		const uint8_t* b = data + position;
+		uint64_t left = end - position;
+		while (left > 0){
+			uint32_t n = (uint32_t)min<uint64_t>(left, UINT32_MAX);
+			parser.tryReadBuffer(b, n);
+			b += n;
+			left -= n;
+		}
+		if (first.seen){
+			// after a late sentence, not before the records it is late for
+			if (first.time > before && add(first.time, position)){
+				if (entries.size() > 1){
+					entries[entries.size() - 2].earliest = span;
+				}
+				span = first.earliest;
+			}
+			else{
+				span = min(span, first.earliest);
+			}
+		}
+		position = end;
+	}
+	if (!entries.empty()){
+		entries.back().earliest = span;
+	}
+	setEarliest();
+	service.publishTo(nullptr);
+}
+
+bool INSTimeIndex::buildFromRecordLog(const string& path, nanoseconds stride){
+	entries.clear();
+	interval = stride;
+	size = 0;
+	source = Source::None;
+
+	INSRecordLogReader reader;
+	if (!reader.open(path)){
+		return false;
+	}
+	INSRecordLogReader::Block block;
+	INSTimestamp::TimePoint latest = INSTimestamp::TimePoint::min();
+	while (reader.nextBlock(block)){
+		if (block.first > latest){
+			add(block.first, block.offset);
+		}
+		latest = max(latest, block.latest);
+	}
+	size = reader.size();
+	source = Source::RecordLog;
+	return true;
+}
+
+string INSTimeIndex::sidecarPath(const string& path){
+	return path + ".idx";
+}
+
+bool INSTimeIndex::save(const string& path) const {
+	vector<uint8_t> out;
+	out.reserve(IndexHeaderSize + entries.size() * IndexEntrySize + 4);
+	out.insert(out.end(), IndexMagic, IndexMagic + 8);
+	put(out, IndexVersion, 2);
+	put(out, (uint8_t)source, 1);
+	put(out, 0, 5);
+	put(out, (uint64_t)interval.count(), 8);
+	put(out, size, 8);
+	put(out, entries.size(), 8);
+	for (const Entry& e : entries){
+		put(out, (uint64_t)e.time.time_since_epoch().count(), 8);
+		put(out, e.offset, 8);
+		put(out, (uint64_t)e.earliest.time_since_epoch().count(), 8);
+	}
+	put(out, crc32c(out.data(), out.size()), 4);
+
+	FILE* f = fopen(path.c_str(), "wb");
+	if (f == nullptr){
+		return false;
+	}
+	bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+	return (fclose(f) == 0) && ok;
+}
+
+bool INSTimeIndex::load(const string& path){
+	MappedFile file;
+	if (!file.open(path)){
+		return false;
+	}
+	const uint8_t* p = file.data();
+	if (file.size() < IndexHeaderSize + 4 || memcmp(p, IndexMagic, 8) != 0 || get(p + 8, 2) != IndexVersion){
+		return false;
+	}
+	uint64_t count = get(p + 32, 8);
+	if (count > (file.size() - IndexHeaderSize - 4) / IndexEntrySize || file.size() != IndexHeaderSize + count * IndexEntrySize + 4){
+		return false;
+	}
+	size_t body = file.size() - 4;
+	if (get(p + body, 4) != crc32c(p, body)){
+		return false;
+	}
+
+	source = (Source)p[10];
+	interval = nanoseconds((int64_t)get(p + 16, 8));
+	size = get(p + 24, 8);
+	entries.resize(count);
+	for (uint64_t i = 0; i < count; i++){
+		const uint8_t* e = p + IndexHeaderSize + i * IndexEntrySize;
+		entries[i].time = INSTimestamp::TimePoint(nanoseconds((int64_t)get(e, 8)));
+		entries[i].offset = get(e + 8, 8);
+		entries[i].earliest = INSTimestamp::TimePoint(nanoseconds((int64_t)get(e + 16, 8)));
+	}
+	return true;
+}
+
+bool INSTimeIndex::load(const string& path, Source logSource, uint64_t logSize){
+	INSTimeIndex index;
+	if (!index.load(path) || index.source != logSource || index.size != logSize){
+		return false;
+	}
+	*this = index;
+	return true;
+}
+
+bool INSTimeIndex::find(INSTimestamp::TimePoint time, Entry& entry) const {
+	auto it = upper_bound(entries.begin(), entries.end(), time, [](INSTimestamp::TimePoint t, const Entry& e){
+		return t < e.time;
+	});
+	if (it == entries.begin()){
+		entry.time = INSTimestamp::TimePoint();
+		entry.offset = (source == Source::RecordLog) ? INSRecordLogFormat::FileHeaderSize : 0;
+		return false;
+	}
+	entry = *(it - 1);
+	return true;
+}
+
+uint64_t INSTimeIndex::endOffset(INSTimestamp::TimePoint time) const {
+	auto it = upper_bound(entries.begin(), entries.end(), time, [](INSTimestamp::TimePoint t, const Entry& e){
+		return t < e.earliest;
+	});
+	return (it == entries.end()) ? size : it->offset;
+}
+
+const vector<INSTimeIndex::Entry>& INSTimeIndex::getEntries() const {
+	return entries;
+}
+
+nanoseconds INSTimeIndex::stride() const {
+	return interval;
+}
+
+uint64_t INSTimeIndex::sourceSize() const {
+	return size;
+}
+
+INSTimeIndex::Source INSTimeIndex::sourceType() const {
+	return source;
+}
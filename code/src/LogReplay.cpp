@@ -0,0 +1,101 @@
+#include <nmeaparse/LogReplay.h>
+#include <algorithm>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+double LogReplayStats::bytesPerSecond() const {
+	return elapsed.count() > 0 ? (double)bytes * 1e9 / (double)elapsed.count() : 0;
+}
+
+
+LogReplay::LogReplay(NMEAParser& p)
+: parser(p)
+, sequentialHint(true)
+, releaseBehind(false)
+, step(16 << 20)
+{ }
+
+LogReplay::~LogReplay()
+{ }
+
+LogReplayStats LogReplay::replay(const MappedFile& file){
+	if (sequentialHint){
+		file.advise(MappedFile::Access::Sequential);
+	}
+	return run(file.data(), 0, file.size(), &file);
+}
+
+LogReplayStats LogReplay::replay(const uint8_t* data, size_t size){
+	return run(data, 0, size, nullptr);
+}
+
+LogReplayStats LogReplay::replay(const MappedFile& file, uint64_t begin, uint64_t end){
+	end = min<uint64_t>(end, file.size());
+	begin = min(begin, end);
+	if (sequentialHint && end > begin){
+		file.advise(MappedFile::Access::Sequential, begin, end - begin);
+	}
+	return run(file.data(), begin, end, &file);
+}
+
+LogReplayStats LogReplay::replay(const MappedFile& file, const INSTimeIndex& index, INSTimestamp::TimePoint from,
+	INSTimestamp::TimePoint to, INSDateTracker& date){
+	if (index.sourceType() != INSTimeIndex::Source::Text || index.sourceSize() != file.size()){
+		return replay(file);
+	}
+	INSTimeIndex::Entry entry;
+	if (index.find(from, entry)){
+		date.setDate(entry.day());
+	}
+	return replay(file, entry.offset, index.endOffset(to));
+}
+
+LogReplayStats LogReplay::run(const uint8_t* data, size_t begin, size_t end, const MappedFile* file){
+	size_t released = begin;
+
+	LogReplayStats stats = LogReplayStats();
+	auto start = steady_clock::now();
+	size_t position = begin;
+	while (position < end){
+		// up to the last newline of the step, so no sentence is split between two calls
+		// and the parser never has to buffer one
+		size_t span = min(max<size_t>(step, 1), min<size_t>(end - position, UINT32_MAX));
+		if (position + span < end){
+			size_t last = span;
+			while (last > 0 && data[position + last - 1] != '\n'){
+				last--;
+			}
+			if (last > 0){
+				span = last;
+			}
+		}
+
+		const uint8_t* b = data + position;
+		uint32_t left = (uint32_t)span;
+		while (left > 0){
+			uint32_t consumed;
+			NMEAParseResult result = parser.tryReadBuffer(b, left, consumed);
+			if (result){
+				break;
+			}
+			stats.errors++;
+			b += consumed;
+			left -= consumed;
+		}
+		position += span;
+
+		if (file != nullptr && releaseBehind && position - released >= step){
+			file->advise(MappedFile::Access::DontNeed, released, position - released);
+			released = position;
+		}
+
+		stats.bytes = position - begin;
+		stats.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+		onProgress(stats);
+	}
+	return stats;
+}
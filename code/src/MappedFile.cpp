@@ -0,0 +1,111 @@
+#include <nmeaparse/MappedFile.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+using namespace nmea;
+
+
+MappedFile::MappedFile()
+: bytes(nullptr)
+, length(0)
+{ }
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& ref)
+: bytes(ref.bytes)
+, length(ref.length)
+{
+	ref.bytes = nullptr;
+	ref.length = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& ref){
+	if (&ref != this){
+		close();
+		bytes = ref.bytes;
+		length = ref.length;
+		ref.bytes = nullptr;
+		ref.length = 0;
+	}
+	return *this;
+}
+
+bool MappedFile::open(const string& path){
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0){
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0){
+		::close(fd);
+		return false;
+	}
+	if (info.st_size == 0){		// mmap refuses a length of 0
+		::close(fd);
+		bytes = reinterpret_cast<const uint8_t*>("");
+		return true;
+	}
+
+	void* map = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);		// the mapping keeps the file
+	if (map == MAP_FAILED){
+		return false;
+	}
+	bytes = static_cast<const uint8_t*>(map);
+	length = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::close(){
+	if (length > 0){
+		munmap(const_cast<uint8_t*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+}
+
+bool MappedFile::isOpen() const {
+	return bytes != nullptr;
+}
+
+const uint8_t* MappedFile::data() const {
+	return bytes;
+}
+
+size_t MappedFile::size() const {
+	return length;
+}
+
+bool MappedFile::advise(Access access, size_t offset, size_t count) const {
+	if (offset >= length){
+		return length == 0;
+	}
+	if (count == 0 || count > length - offset){
+		count = length - offset;
+	}
+
+	// madvise wants a page aligned start
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t skew = offset % page;
+	offset -= skew;
+	count += skew;
+
+	int advice = MADV_NORMAL;
+	switch (access){
+	case Access::Normal:		advice = MADV_NORMAL;		break;
+	case Access::Sequential:	advice = MADV_SEQUENTIAL;	break;
+	case Access::Random:		advice = MADV_RANDOM;		break;
+	case Access::WillNeed:		advice = MADV_WILLNEED;		break;
+	case Access::DontNeed:		advice = MADV_DONTNEED;		break;
+	}
+	return madvise(const_cast<uint8_t*>(bytes) + offset, count, advice) == 0;
+}
@@ -9,10 +9,15 @@
 
 #include <nmeaparse/NMEAParser.h>
 #include <nmeaparse/NumberConversion.h>
+#include <nmeaparse/SIMDKernels.h>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <array>
+#include <type_traits>
+#include <memory>
 
 using namespace std;
 using namespace nmea;
@@ -37,6 +42,24 @@ std::string NMEAParseError::what(){
 
 
 
+// --------- NMEA PARSE RESULT --------------
+
+const char* NMEAParseResult::toString(NMEAParseStatus status){
+	switch (status){
+	case NMEAParseStatus::Ok:					return "Ok";
+	case NMEAParseStatus::InvalidText:			return "Invalid text";
+	case NMEAParseStatus::EmptyChecksum:		return "Checksum '*' character at end, but no data";
+	case NMEAParseStatus::UnreadableChecksum:	return "Checksum not readable as hex";
+	case NMEAParseStatus::InvalidCharacter:		return "Invalid character (non-alpha-num) in parameter";
+	case NMEAParseStatus::ChecksumMismatch:		return "Checksum is invalid";
+	case NMEAParseStatus::MissingParameters:	return "Missing parameters";
+	case NMEAParseStatus::BadNumber:			return "Parameter is not a number";
+	}
+	return "Unknown";
+}
+
+
+
 
 // --------- NMEA SENTENCE --------------
 
@@ -47,9 +70,63 @@ NMEASentence::NMEASentence()
 , parsedChecksum(0)
 { }
 
+NMEASentence::NMEASentence(const NMEASentence& ref)
+: isvalid(ref.isvalid)
+, text(ref.text)
+, parameters(ref.parameters)
+, checksumIsCalculated(ref.checksumIsCalculated)
+, parsedChecksum(ref.parsedChecksum)
+, calculatedChecksum(ref.calculatedChecksum)
+{
+	rebase(ref);
+}
+
 NMEASentence::~NMEASentence()
 { }
 
+NMEASentence& NMEASentence::operator=(const NMEASentence& ref){
+	if (&ref != this){
+		isvalid = ref.isvalid;
+		text = ref.text;
+		parameters = ref.parameters;
+		checksumIsCalculated = ref.checksumIsCalculated;
+		parsedChecksum = ref.parsedChecksum;
+		calculatedChecksum = ref.calculatedChecksum;
+		rebase(ref);
+	}
+	return *this;
+}
+
+// Views that do not point into ref.text (default constructed ones) are left alone.
+void NMEASentence::rebase(const NMEASentence& ref){
+	const char* from = ref.text.data();
+	const char* to = text.data();
+	auto move = [&](string_view v){
+		if (v.data() < from || v.data() > from + ref.text.size()){
+			return v;
+		}
+		return string_view(to + (v.data() - from), v.size());
+	};
+
+	name = move(ref.name);
+	checksum = move(ref.checksum);
+	for (size_t i = 0; i < parameters.size(); i++){
+		parameters[i] = move(ref.parameters[i]);
+	}
+}
+
+// Resets the sentence for a new parse, keeping the capacity of the text and parameter buffers.
+void NMEASentence::clear(){
+	isvalid = false;
+	text.clear();
+	name = string_view();
+	parameters.clear();
+	checksum = string_view();
+	checksumIsCalculated = false;
+	parsedChecksum = 0;
+	calculatedChecksum = 0;
+}
+
 bool NMEASentence::valid() const {
 	return isvalid;
 }
@@ -62,38 +139,31 @@ bool NMEASentence::checksumOK() const {
 
 
 
-// true if the text contains a non-alpha numeric value
-bool hasNonAlphaNum(string txt){
-	for (const char i : txt){
-		if ( !isalnum(i) ){
-			return true;
-		}
-	}
-	return false;
-}
+// Byte classes used by the tokenizer
+enum CharClass : uint8_t {
+	Other,		// not allowed anywhere in a sentence
+	AlphaNum,
+	Sign,		// '+', '-' or '.', allowed in parameters only
+	Space,		// removed from the sentence
+	Dollar,
+	Comma,
+	Star
+};
 
-// true if alphanumeric or '-'
-bool validParamChars(string txt){
-	for (const char i : txt){
-		if (!isalnum(i)){
-			if (i != '+' && i != '-' && i != '.'){
-				return false;
-			}
+static const array<uint8_t, 256> charClasses = []{
+	array<uint8_t, 256> table{};
+	for (int c = 0; c < 256; c++){
+		if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')){
+			table[c] = AlphaNum;
 		}
 	}
-	return true;
-}
-
-// remove all whitespace
-void squish(string& str){
-
-	char chars[] = {'\t',' '};
-	for (const char i : chars)
-	{
-		// needs include <algorithm>
-		str.erase(std::remove(str.begin(), str.end(), i), str.end());
-	}
-}
+	table['+'] = table['-'] = table['.'] = Sign;
+	table[' '] = table['\t'] = Space;
+	table['$'] = Dollar;
+	table[','] = Comma;
+	table['*'] = Star;
+	return table;
+}();
 
 // remove side whitespace
 void trim(string& str){
@@ -104,35 +174,256 @@ void trim(string& str){
 }
 
 
+// --------- TOKENIZER --------------
+
+void NMEAParser::Tokenizer::reset(){
+	text.clear();
+	carriagereturn = false;
+	restart();
+}
+
+void NMEAParser::Tokenizer::restart(){
+	commas.clear();
+	dollar = nameend = firststar = laststar = firstsign = firstother = string::npos;
+	checksum = checksumatstar = 0;
+}
+
+// One step of the forward scan: drops whitespace, tracks the last '$', the name and
+// parameter boundaries and the stars. When running, also the XOR up to the last '*'
+// and the first character that is not allowed.
+void NMEAParser::Tokenizer::push(char c){
+	size_t n = text.size();
+	switch (charClasses[(uint8_t)c]){
+	case Space:
+		return;
+	case Dollar:
+		restart();
+		dollar = n;
+		text.push_back(c);
+		return;
+	case Comma:
+		if (dollar == string::npos){
+			break;
+		}
+		if (nameend == string::npos){
+			nameend = n;
+		}
+		else{
+			commas.push_back((uint32_t)n);
+		}
+		break;
+	case Star:
+		if (firststar == string::npos){
+			firststar = n;
+		}
+		laststar = n;
+		checksumatstar = checksum;
+		break;
+	case Sign:
+		if (running && firstsign == string::npos){
+			firstsign = n;
+		}
+		break;
+	case Other:
+		if (running && firstother == string::npos){
+			firstother = n;
+		}
+		break;
+	default:
+		break;
+	}
+	if (running){
+		checksum ^= (uint8_t)c;
+	}
+	text.push_back(c);
+}
+
+
+
 // --------- NMEA PARSER --------------
 
 
 
 NMEAParser::NMEAParser() 
-: log(false)
-, maxbuffersize(NMEA_PARSER_MAX_BUFFER_SIZE)
+: eventTable(make_shared<vector<SentenceReader>>())
+, buffered(0)
 , fillingbuffer(false)
-{ }
+, maxbuffersize(NMEA_PARSER_MAX_BUFFER_SIZE)
+, log(false)
+, logLevel(NMEALogLevel::Info)
+, prefilter(false)
+{
+	stream.running = true;
+	stream.reset();
+	line.running = false;
+	line.reset();
+}
 
 NMEAParser::~NMEAParser() 
 { }
 
 
+// Loggers
+template<class Message>
+void NMEAParser::onLog(NMEALogLevel level, NMEASentence& nmea, const Message& message){
+	if (!logging(level)){
+		return;
+	}
+	if constexpr (is_convertible<Message, string_view>::value){
+		writeLog(level, nmea, message);
+	}
+	else{
+		writeLog(level, nmea, message());
+	}
+}
+template<class Message>
+void NMEAParser::onInfo(NMEASentence& nmea, const Message& message){
+	onLog(NMEALogLevel::Info, nmea, message);
+}
+template<class Message>
+void NMEAParser::onWarning(NMEASentence& nmea, const Message& message){
+	onLog(NMEALogLevel::Warning, nmea, message);
+}
+void NMEAParser::writeLog(NMEALogLevel level, NMEASentence& nmea, string_view txt){
+	if (logSink){
+		logSink(level, txt, nmea);
+		return;
+	}
+	switch (level){
+	case NMEALogLevel::Info:	cout << "[Info]    ";	break;
+	case NMEALogLevel::Warning:	cout << "[Warning] ";	break;
+	default:					cout << "[Error]   ";	break;
+	}
+	cout << txt << endl;
+}
+
+// Packs the first 8 characters big-endian, so keys sort like the names they come from.
+uint64_t NMEAParser::sentenceKey(string_view name){
+	uint64_t key = 0;
+	size_t n = min<size_t>(name.size(), 8);
+	for (size_t i = 0; i < 8; i++){
+		key <<= 8;
+		if (i < n){
+			key |= (uint8_t)name[i];
+		}
+	}
+	return key;
+}
+
+const NMEAParser::SentenceReader* NMEAParser::findSentenceReader(string_view name) const {
+	uint64_t key = sentenceKey(name);
+	auto it = lower_bound(eventTable->begin(), eventTable->end(), key, [](const SentenceReader& entry, uint64_t k){
+		return entry.key < k;
+	});
+	for (; it != eventTable->end() && it->key == key; ++it){
+		if (it->name == name){		// only longer names or names with a NUL share a key
+			return &*it;
+		}
+	}
+	return nullptr;
+}
+
 void NMEAParser::setSentenceHandler(std::string cmdKey, std::function<void(const NMEASentence&)> handler){
-	eventTable.erase(cmdKey);
-	eventTable.insert({ cmdKey, handler });
+	std::function<NMEAParseResult(const NMEASentence&)> reader;
+	if (handler){
+		reader = [handler](const NMEASentence& nmea){
+			handler(nmea);
+			return NMEAParseResult();
+		};
+	}
+	setSentenceReader(cmdKey, reader);
+}
+void NMEAParser::setSentenceReader(std::string cmdKey, std::function<NMEAParseResult(const NMEASentence&)> reader){
+	uint64_t key = sentenceKey(cmdKey);
+	auto it = lower_bound(eventTable->begin(), eventTable->end(), key, [](const SentenceReader& entry, uint64_t k){
+		return entry.key < k;
+	});
+	for (; it != eventTable->end() && it->key == key; ++it){
+		if (it->name == cmdKey){
+			it->reader = std::move(reader);
+			return;
+		}
+	}
+	eventTable->insert(it, SentenceReader{ key, std::move(cmdKey), std::move(reader) });
+}
+void NMEAParser::shareSentenceReaders(NMEAParser& parser){
+	eventTable = parser.eventTable;
+}
+// Only sentences with a name are dropped, so the counts are always attributed.
+bool NMEAParser::dropSentence(string_view name){
+	if (onSentence.enabled && !onSentence.empty()){
+		return false;
+	}
+	const SentenceReader* entry = findSentenceReader(name);
+	if (entry != nullptr && entry->reader){
+		return false;
+	}
+
+	uint64_t key = sentenceKey(name);
+	auto it = lower_bound(dropped.begin(), dropped.end(), key, [](const DroppedSentences& entry, uint64_t k){
+		return entry.key < k;
+	});
+	for (; it != dropped.end() && it->key == key; ++it){
+		if (it->name == name){
+			it->count++;
+			return true;
+		}
+	}
+	dropped.insert(it, DroppedSentences{ key, string(name), 1 });
+	return true;
+}
+
+// Same name as the tokenizer finds: alphanumeric between the last '$' and the first comma
+// or the end. Names with whitespace or other characters are left to the full parse.
+bool NMEAParser::frameName(string_view cmd, string_view& name){
+	size_t dollar = cmd.rfind('$');
+	if (dollar == string::npos){
+		return false;
+	}
+	size_t i = dollar + 1;
+	while (i < cmd.size() && charClasses[(uint8_t)cmd[i]] == AlphaNum){
+		i++;
+	}
+	if (i == dollar + 1 || (i < cmd.size() && cmd[i] != ',')){
+		return false;
+	}
+	name = cmd.substr(dollar + 1, i - dollar - 1);
+	return true;
+}
+
+uint64_t NMEAParser::droppedSentenceCount(string_view name) const {
+	for (const auto& entry : dropped){
+		if (entry.name == name){
+			return entry.count;
+		}
+	}
+	return 0;
+}
+
+vector<pair<string, uint64_t>> NMEAParser::getDroppedSentenceCounts() const {
+	vector<pair<string, uint64_t>> counts;
+	counts.reserve(dropped.size());
+	for (const auto& entry : dropped){
+		counts.emplace_back(entry.name, entry.count);
+	}
+	return counts;
 }
+
+void NMEAParser::clearDroppedSentenceCounts(){
+	dropped.clear();
+}
+
 string NMEAParser::getRegisteredSentenceHandlersCSV()
 {
-	if(eventTable.empty()){
+	if(eventTable->empty()){
 		return "";
 	}
 
 	ostringstream ss;
-	for(const auto& table : eventTable){
-		ss << table.first;
+	for(const auto& table : *eventTable){
+		ss << table.name;
 
-		if( ! table.second ){
+		if( ! table.reader ){
 			ss << "(not callable)";
 		}
 		ss << ",";
@@ -144,137 +435,315 @@ string NMEAParser::getRegisteredSentenceHandlersCSV()
 	return s;
 }
 
+void NMEAParser::resetStream(){
+	fillingbuffer = false;
+	buffered = 0;
+}
+
+// Feeds the sentence being received to its tokenizer, holding back a '\r' until
+// we know whether it is the one in front of the newline.
+void NMEAParser::streamBytes(const char* b, size_t size){
+	buffered += (uint32_t)size;
+	for (size_t i = 0; i < size; i++){
+		if (stream.carriagereturn){
+			stream.carriagereturn = false;
+			stream.push('\r');
+		}
+		if (b[i] == '\r'){
+			stream.carriagereturn = true;
+		}
+		else{
+			stream.push(b[i]);
+		}
+	}
+}
+
+// The newline of the sentence in the byte stream arrived, everything but the final checks is already done.
+NMEAParseResult NMEAParser::readStreamSentence(){
+
+	NMEASentence& nmea = sentence;
+	nmea.clear();
+
+	onInfo(nmea, "Processing NEW string...");
+
+	if (prefilter && stream.dollar != string::npos){
+		// the name is framed already, same rule as frameName once the whitespace is gone
+		const Tokenizer& t = stream;
+		size_t nonalphanum = min(min(t.firstsign, t.firststar), t.firstother);
+		size_t nameend = (t.nameend != string::npos) ? t.nameend : t.text.size();
+		if (nameend > t.dollar + 1 && (nonalphanum == string::npos || nonalphanum > nameend)){
+			string_view name(t.text.data() + t.dollar + 1, nameend - t.dollar - 1);
+			if (dropSentence(name)){
+				onInfo(nmea, [&]{ return "Dropped sentence named \"" + string(name) + "\", nobody reads it."; });
+				return NMEAParseResult();
+			}
+		}
+	}
+
+	size_t rawsize = buffered;
+	if (stream.carriagereturn){
+		rawsize--;
+	}
+	else{
+		onWarning(nmea, "Malformed newline, missing carriage return (\\r) ");
+	}
+
+	return readTokens(nmea, stream, rawsize);
+}
+
 void NMEAParser::readByte(uint8_t b){
+	NMEAParseResult result = tryReadByte(b);
+	if (!result){
+		onError(result);
+	}
+}
+
+NMEAParseResult NMEAParser::tryReadByte(uint8_t b){
 	uint8_t startbyte = '$';
+	NMEAParseResult result;
 
 	if (fillingbuffer){
 		if (b == '\n'){
-			buffer.push_back(b);
 			try {
-				readSentence(buffer);
-				buffer.clear();
-				fillingbuffer = false;
+				result = readStreamSentence();
+				resetStream();
 			}
 			catch (exception&){
 				// If anything happens, let it pass through, but reset the buffer first.
-				buffer.clear();
-				fillingbuffer = false;
+				resetStream();
 				throw;
 			}
 		}
 		else{
-			if (buffer.size() < maxbuffersize){
-				buffer.push_back(b);
+			if (buffered < maxbuffersize){
+				streamBytes((const char*)&b, 1);
 			}
 			else {
-				buffer.clear();			//clear the host buffer so it won't overflow.
-				fillingbuffer = false;
+				resetStream();			//clear the host buffer so it won't overflow.
 			}
 		}
 	}
 	else {
 		if (b == startbyte){			// only start filling when we see the start byte.
 			fillingbuffer = true;
-			buffer.push_back(b);
+			stream.reset();
+			streamBytes((const char*)&b, 1);
 		}
 	}
+	return result;
+}
+
+void NMEAParser::readBuffer(const uint8_t* b, uint32_t size){
+	uint32_t consumed;
+	NMEAParseResult result = readStream(b, size, consumed);
+	if (!result){
+		onError(result);
+	}
 }
 
-void NMEAParser::readBuffer(uint8_t* b, uint32_t size){
-	for (uint32_t i = 0; i < size; ++i){
-		readByte(b[i]);
+NMEAParseResult NMEAParser::tryReadBuffer(const uint8_t* b, uint32_t size, uint32_t& consumed){
+	return readStream(b, size, consumed);
+}
+
+NMEAParseResult NMEAParser::tryReadBuffer(const uint8_t* b, uint32_t size){
+	uint32_t consumed;
+	return readStream(b, size, consumed);
+}
+
+// Same state machine as readByte, but jumps between the delimiters with memchr.
+// Sentences that are complete in b are handed to tryReadSentence straight out of it,
+// only the bytes of a sentence spanning several chunks go through the stream tokenizer.
+// Stops after the first sentence that fails, consumed tells how far it got in b.
+NMEAParseResult NMEAParser::readStream(const uint8_t* b, uint32_t size, uint32_t& consumed){
+	const char* p = reinterpret_cast<const char*>(b);
+	const char* end = p + size;
+	consumed = size;
+
+	while (p < end){
+		const char* start = nullptr;		// start of a sentence that began in this chunk
+		if (!fillingbuffer){
+			p = static_cast<const char*>(memchr(p, '$', end - p));
+			if (p == nullptr){
+				break;
+			}
+			fillingbuffer = true;		// only start filling when we see the start byte.
+			stream.reset();
+			start = p++;
+		}
+
+		// readByte drops the sentence on the first non-newline byte that comes in while the buffer is full
+		size_t filled = (start != nullptr) ? (size_t)(p - start) : buffered;
+		size_t room = (filled < maxbuffersize) ? maxbuffersize - filled : 0;
+		size_t span = min<size_t>(room + 1, end - p);
+
+		const char* newline = static_cast<const char*>(memchr(p, '\n', span));
+		if (newline == nullptr){
+			if (span > room){
+				resetStream();			//clear the host buffer so it won't overflow.
+				p += room + 1;
+				continue;
+			}
+			streamBytes((start != nullptr) ? start : p, end - ((start != nullptr) ? start : p));
+			break;
+		}
+
+		NMEAParseResult result;
+		try {
+			if (start != nullptr){
+				result = tryReadSentence(string_view(start, newline + 1 - start));
+			}
+			else{
+				streamBytes(p, newline - p);
+				result = readStreamSentence();
+			}
+			resetStream();
+		}
+		catch (exception&){
+			// If anything happens, let it pass through, but reset the buffer first.
+			resetStream();
+			throw;
+		}
+		p = newline + 1;
+
+		if (!result){
+			consumed = (uint32_t)(p - reinterpret_cast<const char*>(b));
+			return result;
+		}
 	}
+	return NMEAParseResult();
 }
 
 void NMEAParser::readLine(string cmd){
 	cmd += "\r\n";
-	for (const char i : cmd){
-		readByte(i);
-	}
+	readBuffer(reinterpret_cast<const uint8_t*>(cmd.data()), (uint32_t)cmd.size());
 }
 
-// Loggers
-void NMEAParser::onInfo(NMEASentence& nmea, string txt){
-	if (log){
-		cout << "[Info]    " << txt << endl;
+// Only the throwing API and the error log pay for building the message.
+string NMEAParser::errorMessage(const NMEAParseResult& result){
+	const NMEASentence& nmea = sentence;
+	stringstream ss;
+
+	// the parameter holding the offset
+	size_t i = 0;
+	while (i + 1 < nmea.parameters.size() && nmea.parameters[i].data() + nmea.parameters[i].size() < nmea.text.data() + result.offset){
+		i++;
 	}
+	string_view param = nmea.parameters.empty() ? string_view() : nmea.parameters[i];
+
+	switch (result.status){
+	case NMEAParseStatus::InvalidText:
+		if (nmea.text.size() > 35){
+			ss << "Invalid text. (\"" << nmea.text.substr(0, 35) << "...\")";
+		}
+		else{
+			ss << "Invalid text. (\"" << nmea.text << "\")";
+		}
+		break;
+	case NMEAParseStatus::EmptyChecksum:
+		ss << "Checksum '*' character at end, but no data.";
+		break;
+	case NMEAParseStatus::UnreadableChecksum:
+		ss << "parseInt() error. Parsed checksum string was not readable as hex. (\"" << nmea.checksum << "\")";
+		break;
+	case NMEAParseStatus::InvalidCharacter:
+		ss << "Invalid character (non-alpha-num) in parameter " << i << " (from 0): \"" << param << "\"";
+		break;
+	case NMEAParseStatus::ChecksumMismatch:
+		ss << "Checksum is invalid!";
+		break;
+	case NMEAParseStatus::MissingParameters:
+		ss << "INS data is missing parameters.";
+		break;
+	case NMEAParseStatus::BadNumber:
+		ss << "NumberConversionError: argument \"" << param << "\" of parameter " << i << " is not a number.";
+		break;
+	default:
+		ss << NMEAParseResult::toString(result.status);
+		break;
+	}
+
+	if (result.context == nullptr){
+		return "[ERROR] " + ss.str();
+	}
+	return string(result.context) + " :: " + ss.str();
 }
-void NMEAParser::onWarning(NMEASentence& nmea, string txt){
-	if (log){
-		cout << "[Warning] " << txt << endl;
+
+void NMEAParser::onError(const NMEAParseResult& result){
+	if (result.context == nullptr){
+		throw NMEAParseError(errorMessage(result));
 	}
-}
-void NMEAParser::onError(NMEASentence& nmea, string txt){
-	throw NMEAParseError("[ERROR] " + txt);
+	throw NMEAParseError(errorMessage(result), sentence);
 }
 
 // takes a complete NMEA string and gets the data bits from it,
 // calls the corresponding handler in eventTable, based on the 5 letter sentence code
-void NMEAParser::readSentence(std::string cmd){
+void NMEAParser::readSentence(std::string_view cmd){
+	NMEAParseResult result = tryReadSentence(cmd);
+	if (!result){
+		onError(result);
+	}
+}
 
-	NMEASentence nmea;
+NMEAParseResult NMEAParser::tryReadSentence(std::string_view cmd){
+
+	NMEASentence& nmea = sentence;
+	nmea.clear();
 
 	onInfo(nmea, "Processing NEW string...");
 	
 	if (cmd.empty()){
 		onWarning(nmea, "Blank string -- Skipped processing.");
-		return;
+		return NMEAParseResult();
 	}
 	
 	// If there is a newline at the end (we are coming from the byte reader
-	if ( *(cmd.end()-1) == '\n'){
-		if (*(cmd.end() - 2) == '\r'){	// if there is a \r before the newline, remove it.
-			cmd = cmd.substr(0, cmd.size() - 2);
+	if (cmd.back() == '\n'){
+		if (cmd.size() > 1 && cmd[cmd.size() - 2] == '\r'){	// if there is a \r before the newline, remove it.
+			cmd.remove_suffix(2);
 		}
 		else
 		{
 			onWarning(nmea, "Malformed newline, missing carriage return (\\r) ");
-			cmd = cmd.substr(0, cmd.size()-1);
+			cmd.remove_suffix(1);
 		}
 	}
 
-	ios_base::fmtflags oldflags = cout.flags();
+	string_view name;
+	if (prefilter && frameName(cmd, name) && dropSentence(name)){
+		onInfo(nmea, [&]{ return "Dropped sentence named \"" + string(name) + "\", nobody reads it."; });
+		return NMEAParseResult();
+	}
 
-	// Remove all whitespace characters.
-	size_t beginsize = cmd.size();
-	squish(cmd);
-	if (cmd.size() != beginsize){
-		stringstream ss;
-		ss << "New NMEA string was full of " << (beginsize - cmd.size()) << " whitespaces!";
-		onWarning(nmea, ss.str());
+	// Seperates the data, whitespace is dropped on the way
+	line.reset();
+	line.text.reserve(cmd.size());
+	for (const char c : cmd){
+		line.push(c);
 	}
 
-	
-	onInfo(nmea, string("NMEA string: (\"") + cmd + "\")");
-	
+	return readTokens(nmea, line, cmd.size());
+}
 
-	// Seperates the data now that everything is formatted
-	try{
-		parseText(nmea, cmd);
-	}
-	catch (NMEAParseError&){
-		throw;
-	}
-	catch (std::exception& e){
-		string s = " >> NMEA Parser Internal Error: Indexing error?... ";
-		throw std::runtime_error(s + e.what());
-	}
-	cout.flags(oldflags);  //reset
+// Second half of tryReadSentence, shared with the byte stream which tokenizes as the bytes come in.
+NMEAParseResult NMEAParser::readTokens(NMEASentence& nmea, Tokenizer& tokens, size_t rawsize){
 
-	// Handle/Throw parse errors
-	if (!nmea.valid()){
+	NMEAParseResult result = parseTokens(nmea, tokens);
 
-		size_t linewidth = 35;
-		stringstream ss;
-		if (nmea.text.size() > linewidth){
-			ss << "Invalid text. (\"" << nmea.text.substr(0, linewidth) << "...\")";
-		}
-		else{
-			ss << "Invalid text. (\"" << nmea.text << "\")";
-		}
+	if (nmea.text.size() != rawsize){
+		onWarning(nmea, [&]{
+			return "New NMEA string was full of " + to_string(rawsize - nmea.text.size()) + " whitespaces!";
+		});
+	}
 
-		onError(nmea, ss.str());
-		return;
+	onInfo(nmea, [&]{ return "NMEA string: (\"" + nmea.text + "\")"; });
+
+	// Handle parse errors
+	if (result && !nmea.valid()){
+		result = NMEAParseResult(NMEAParseStatus::InvalidText);
+	}
+	if (!result){
+		onLog(NMEALogLevel::Error, nmea, [&]{ return errorMessage(result); });
+		return result;
 	}
 	
 
@@ -284,31 +753,26 @@ void NMEAParser::readSentence(std::string cmd){
 
 
 	// Call event handlers based on map entries
-	function<void(const NMEASentence&)> handler = eventTable[nmea.name];
-	if (handler){
-		onInfo(nmea, string("Calling specific handler for sentence named \"") + nmea.name + "\"");
-		handler(nmea);
+	const SentenceReader* entry = findSentenceReader(nmea.name);
+	if (entry != nullptr && entry->reader){
+		onInfo(nmea, [&]{ return "Calling specific handler for sentence named \"" + string(nmea.name) + "\""; });
+		result = entry->reader(nmea);
+		if (!result){
+			onLog(NMEALogLevel::Error, nmea, [&]{ return errorMessage(result); });
+		}
 	}
 	else
 	{
-		onWarning(nmea, string("Null event handler for type (name: \"") + nmea.name + "\")");
+		onWarning(nmea, [&]{ return "Null event handler for type (name: \"" + string(nmea.name) + "\")"; });
 	}
 
-
-
-
-
-	cout.flags(oldflags);  //reset
-
+	return result;
 }
 
 // takes the string *between* the '$' and '*' in nmea sentence,
 // then calculates a rolling XOR on the bytes
-uint8_t NMEAParser::calculateChecksum(string s){
-	uint8_t checksum = 0;
-	for (const char i : s){
-		checksum = checksum ^ i;
-	}
+uint8_t NMEAParser::calculateChecksum(string_view s){
+	uint8_t checksum = xorChecksum(s.data(), s.size());
 
 	// will display the calculated checksum in hex
 	//if(log)
@@ -321,39 +785,33 @@ uint8_t NMEAParser::calculateChecksum(string s){
 }
 
 
-void NMEAParser::parseText(NMEASentence& nmea, string txt){
-
-	if (txt.empty()){
-		nmea.isvalid = false;
-		return;
-	}
+// Takes the text of the tokenizer and applies the rules of the format to what it found.
+// All the fields are views into nmea.text, nothing is copied out of it.
+NMEAParseResult NMEAParser::parseTokens(NMEASentence& nmea, Tokenizer& tokens){
 
 	nmea.isvalid = false;	// assume it's invalid first
-	nmea.text = txt;		// save the received text of the sentence
 
-	// Looking for index of last '$'
-	size_t startbyte = 0;
-	size_t dollar = txt.find_last_of('$');
-	if (dollar == string::npos){
-		// No dollar sign... INVALID!
-		return;
-	}
-	else
-	{
-		startbyte = dollar;
-	}
+	const size_t npos = string::npos;
+	nmea.text.swap(tokens.text);
+	const char* out = nmea.text.data();
+	size_t n = nmea.text.size();
 
+	if (n == 0){
+		return NMEAParseResult();
+	}
 
-	// Get rid of data up to last'$'
-	txt = txt.substr(startbyte + 1);
+	if (tokens.dollar == npos){
+		// No dollar sign... INVALID!
+		return NMEAParseResult();
+	}
 
 
 	// Look for checksum
-	size_t checkstri = txt.find_last_of('*');
-	bool haschecksum = checkstri != string::npos;
+	bool haschecksum = tokens.laststar != npos;
 	if (haschecksum){
 		// A checksum was passed in the message, so calculate what we expect to see
-		nmea.calculatedChecksum = calculateChecksum(txt.substr(0, checkstri));
+		nmea.calculatedChecksum = tokens.running ? tokens.checksumatstar
+			: xorChecksum(out + tokens.dollar + 1, tokens.laststar - tokens.dollar - 1);
 	}
 	else
 	{
@@ -361,110 +819,108 @@ void NMEAParser::parseText(NMEASentence& nmea, string txt){
 		onWarning(nmea, "No checksum information provided. Could not find '*'.");
 	}
 
+	// The name may only be alphanumeric
+	size_t nameend = (tokens.nameend != npos) ? tokens.nameend : n;
+	bool alphanumname;
+	if (tokens.running){
+		size_t nonalphanum = min(min(tokens.firstsign, tokens.firststar), tokens.firstother);
+		alphanumname = nonalphanum == npos || nonalphanum > nameend;
+	}
+	else{
+		alphanumname = all_of(out + tokens.dollar + 1, out + nameend, [](char c){
+			return charClasses[(uint8_t)c] == AlphaNum;
+		});
+	}
+
 	// Handle comma edge cases
-	size_t comma = txt.find(',');
-	if (comma == string::npos){		//comma not found, but there is a name...
-		if (!txt.empty())
+	if (tokens.nameend == npos){		//comma not found, but there is a name...
+		if (n > tokens.dollar + 1)
 		{	// the received data must just be the name
-			if ( hasNonAlphaNum(txt) ){
+			if (!alphanumname){
 				nmea.isvalid = false;
-				return;
+				return NMEAParseResult();
 			}
-			nmea.name = txt;
+			nmea.name = string_view(out + tokens.dollar + 1, n - tokens.dollar - 1);
 			nmea.isvalid = true;
-			return;
+			return NMEAParseResult();
 		}
 		else
 		{	//it is a '$' with no information
 			nmea.isvalid = false;
-			return;	
+			return NMEAParseResult();	
 		}
 	}
 
 	//"$," case - no name
-	if (comma == 0){
+	if (tokens.nameend == tokens.dollar + 1){
 		nmea.isvalid = false;
-		return;
+		return NMEAParseResult();
 	}
 
 
 	//name should not include first comma
-	nmea.name = txt.substr(0, comma);	
-	if ( hasNonAlphaNum(nmea.name) ){
+	nmea.name = string_view(out + tokens.dollar + 1, tokens.nameend - tokens.dollar - 1);
+	if (!alphanumname){
 		nmea.isvalid = false;
-		return;
+		return NMEAParseResult();
 	}
 
 
-	//comma is the last character/only comma
-	if (comma + 1 == txt.size()){		
-		nmea.parameters.push_back("");
-		nmea.isvalid = true;
-		return;	
+	// parameters are between the commas, a comma at the end gives a last blank parameter
+	size_t fieldstart = tokens.nameend + 1;
+	for (const uint32_t comma : tokens.commas){
+		nmea.parameters.push_back(string_view(out + fieldstart, comma - fieldstart));
+		fieldstart = comma + 1;
 	}
+	nmea.parameters.push_back(string_view(out + fieldstart, n - fieldstart));
 
-
-	//move to data after first comma
-	txt = txt.substr(comma + 1, txt.size() - (comma + 1));
-
-	//parse parameters according to csv
-	istringstream f(txt);
-	string s;
-	while (getline(f, s, ',')) {
-		//cout << s << endl;
-		nmea.parameters.push_back(s);
+	//comma is the last character/only comma
+	if (tokens.nameend + 1 == n){
+		nmea.isvalid = true;
+		return NMEAParseResult();
 	}
 
 
-	//above line parsing does not add a blank parameter if there is a comma at the end...
-	// so do it here.
-	if (*(txt.end() - 1) == ','){
+	size_t paramsend = n;
+	if (out[n - 1] == ','){
 
 		// supposed to have checksum but there is a comma at the end... invalid
 		if (haschecksum){
 			nmea.isvalid = false;
-			return;
+			return NMEAParseResult();
 		}
 
 		//cout << "NMEA parser Warning: extra comma at end of sentence, but no information...?" << endl;		// it's actually standard, if checksum is disabled
-		nmea.parameters.push_back("");
 
-		stringstream sz;
-		sz << "Found " << nmea.parameters.size() << " parameters.";
-		onInfo(nmea, sz.str());
+		onInfo(nmea, [&]{ return "Found " + to_string(nmea.parameters.size()) + " parameters."; });
 
 	}
 	else
 	{
-		stringstream sz;
-		sz << "Found " << nmea.parameters.size() << " parameters.";
-		onInfo(nmea, sz.str());
+		onInfo(nmea, [&]{ return "Found " + to_string(nmea.parameters.size()) + " parameters."; });
 
 		//possible checksum at end...
-		size_t endi = nmea.parameters.size() - 1;
-		size_t checki = nmea.parameters[endi].find_last_of('*');
-		if (checki != string::npos){
-			string last = nmea.parameters[endi];
-			nmea.parameters[endi] = last.substr(0, checki);
-			if (checki == last.size() - 1){
-				onError(nmea, "Checksum '*' character at end, but no data.");
+		size_t laststar = tokens.laststar;
+		if (haschecksum && laststar >= fieldstart){
+			string_view& last = nmea.parameters.back();
+			last = string_view(out + fieldstart, laststar - fieldstart);
+			paramsend = laststar;
+			if (laststar == n - 1){
+				return NMEAParseResult(NMEAParseStatus::EmptyChecksum, (uint32_t)laststar);
 			}
 			else{
-				nmea.checksum = last.substr(checki + 1, last.size() - checki);		//extract checksum without '*'
+				nmea.checksum = string_view(out + laststar + 1, n - laststar - 1);		//extract checksum without '*'
 
-				onInfo(nmea, string("Found checksum. (\"*") + nmea.checksum + "\")");
+				onInfo(nmea, [&]{ return "Found checksum. (\"*" + string(nmea.checksum) + "\")"; });
 
-				try
-				{
-					nmea.parsedChecksum = (uint8_t)parseInt(nmea.checksum, 16);
-					nmea.checksumIsCalculated = true;
-				}
-				catch( NumberConversionError& )
-				{
-					onError(nmea, string("parseInt() error. Parsed checksum string was not readable as hex. (\"") +  nmea.checksum + "\")");
+				int64_t parsed;
+				if (!tryParseInt(nmea.checksum, parsed, 16)){
+					return NMEAParseResult(NMEAParseStatus::UnreadableChecksum, (uint32_t)laststar + 1);
 				}
+				nmea.parsedChecksum = (uint8_t)parsed;
+				nmea.checksumIsCalculated = true;
 				
-				onInfo(nmea, string("Checksum ok? ") + (nmea.checksumOK() ? "YES" : "NO") + "!");
+				onInfo(nmea, nmea.checksumOK() ? "Checksum ok? YES!" : "Checksum ok? NO!");
 				
 
 			}
@@ -472,21 +928,23 @@ void NMEAParser::parseText(NMEASentence& nmea, string txt){
 	}
 
 
-	for (size_t i = 0; i < nmea.parameters.size(); i++){
-		if (!validParamChars(nmea.parameters[i])){
-			nmea.isvalid = false;
-			stringstream ss;
-			ss << "Invalid character (non-alpha-num) in parameter " << i << " (from 0): \"" << nmea.parameters[i] << "\"";
-			onError(nmea, ss.str() );
-			break;
-		}
+	// Any '*' left in the parameters is invalid, as are the characters of class Other.
+	size_t invalid;
+	if (tokens.running){
+		invalid = min(tokens.firststar, tokens.firstother);
+	}
+	else{
+		size_t paramsbegin = tokens.nameend + 1;
+		invalid = paramsbegin + findInvalidParamChar(out + paramsbegin, paramsend - paramsbegin);
+	}
+	if (invalid < paramsend){
+		nmea.isvalid = false;
+		return NMEAParseResult(NMEAParseStatus::InvalidCharacter, (uint32_t)invalid);
 	}
 
 
 	nmea.isvalid = true;
 
-	return;
+	return NMEAParseResult();
 
 }
-
-
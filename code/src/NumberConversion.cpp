@@ -9,16 +9,70 @@
 
 #include <nmeaparse/NumberConversion.h>
 #include <cstdlib>
+#include <charconv>
 
 using namespace std;
 
 namespace nmea {
 // Note: both parseDouble and parseInt return 0 with "" input.
 
-		double parseDouble(std::string s){
+		// strtod/strtoll need a terminated string, NMEA fields are short enough to copy on the stack.
+		class TerminatedField {
+		private:
+			char local[64];
+			std::string heap;
+			const char* str;
+		public:
+			TerminatedField(std::string_view s){
+				if (s.size() < sizeof(local)){
+					s.copy(local, s.size());
+					local[s.size()] = 0;
+					str = local;
+				}
+				else{
+					heap.assign(s.data(), s.size());
+					str = heap.c_str();
+				}
+			}
+			const char* c_str() const{
+				return str;
+			}
+		};
+
+		// from_chars is exact like strtod, but does not need the copy and ignores the locale.
+		// It only takes the fields it reads entirely, the rest (hex, overflow, ""...)
+		// goes to strtod so the results stay the same.
+		static std::string_view skipPlus(std::string_view s){
+			if (s.size() > 1 && s[0] == '+' && (s[1] == '.' || (s[1] >= '0' && s[1] <= '9'))){
+				s.remove_prefix(1);
+			}
+			return s;
+		}
+
+		static bool fastParseDouble(std::string_view s, double& d){
+			s = skipPlus(s);
+			const char* end = s.data() + s.size();
+			std::from_chars_result r = std::from_chars(s.data(), end, d);
+			return r.ec == std::errc() && r.ptr == end;
+		}
+
+		static bool fastParseInt(std::string_view s, int64_t& d, int radix){
+			s = skipPlus(s);
+			const char* end = s.data() + s.size();
+			std::from_chars_result r = std::from_chars(s.data(), end, d, radix);
+			return r.ec == std::errc() && r.ptr == end;
+		}
+
+		double parseDouble(std::string_view s){
+
+			double d;
+			if (fastParseDouble(s, d)){
+				return d;
+			}
 
+			TerminatedField field(s);
 			char* p;
-			double d = ::strtod(s.c_str(), &p);
+			d = ::strtod(field.c_str(), &p);
 
 			if (*p != 0){
 				std::stringstream ss;
@@ -30,10 +84,16 @@ namespace nmea {
 			return d;
 		}
 
-		int64_t parseInt(std::string s, int radix){
+		int64_t parseInt(std::string_view s, int radix){
 
+			int64_t d;
+			if (radix >= 2 && radix <= 36 && fastParseInt(s, d, radix)){
+				return d;
+			}
+
+			TerminatedField field(s);
 			char* p;
-			int64_t d = ::strtoll(s.c_str(), &p, radix);
+			d = ::strtoll(field.c_str(), &p, radix);
 
 			if (*p != 0){
 				std::stringstream ss;
@@ -46,7 +106,27 @@ namespace nmea {
 
 		}
 
-		bool parseBool(std::string s){
+		bool tryParseDouble(std::string_view s, double& d){
+			if (fastParseDouble(s, d)){
+				return true;
+			}
+			TerminatedField field(s);
+			char* p;
+			d = ::strtod(field.c_str(), &p);
+			return *p == 0;
+		}
+
+		bool tryParseInt(std::string_view s, int64_t& d, int radix){
+			if (radix >= 2 && radix <= 36 && fastParseInt(s, d, radix)){
+				return true;
+			}
+			TerminatedField field(s);
+			char* p;
+			d = ::strtoll(field.c_str(), &p, radix);
+			return *p == 0;
+		}
+
+		bool parseBool(std::string_view s){
 
 			bool d;
 
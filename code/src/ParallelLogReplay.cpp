@@ -0,0 +1,250 @@
+#include <nmeaparse/ParallelLogReplay.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+using namespace nmea;
+
+
+// ------------- CHUNKS -------------
+
+namespace {
+
+	// What a worker made of one chunk
+	struct ChunkResult {
+		vector<INSRecord> records;
+		vector<uint32_t> steps;		// for each record, the number of date steps taken before it
+		vector<INSDateTracker::Step> journal;
+		uint64_t errors = 0;
+		exception_ptr error;
+		bool done = false;
+	};
+
+	// Collects the records published by the service of a worker, see INSService::publishTo
+	struct ChunkBatch {
+		ChunkResult* result = nullptr;
+
+		void push(const INSRecord& record){
+			result->records.push_back(record);
+			result->steps.push_back((uint32_t)result->journal.size());
+		}
+	};
+
+	struct Worker {
+		NMEAParser parser;
+		INSService service;
+		ChunkBatch batch;
+		thread worker;
+
+		Worker() : service(parser)
+		{
+			service.publishTo(batch);
+		}
+	};
+
+	INSTimestamp::TimePoint& recordTime(INSRecord& record){
+		switch (record.type){
+		case INSRecordType::AIPOV:		return record.aipov.time;
+		case INSRecordType::TECHSAS:	return record.techsas.time;
+		case INSRecordType::IXSEA_TAH:	return record.ixsea_tah.time;
+		default:						return record.zda.time;
+		}
+	}
+
+	void parseChunk(NMEAParser& parser, const uint8_t* b, size_t size, uint64_t& errors){
+		while (size > 0){
+			uint32_t left = (uint32_t)min<size_t>(size, UINT32_MAX);
+			size -= left;
+			while (left > 0){
+				uint32_t consumed;
+				NMEAParseResult result = parser.tryReadBuffer(b, left, consumed);
+				if (result){
+					b += left;
+					break;
+				}
+				errors++;
+				b += consumed;
+				left -= consumed;
+			}
+		}
+	}
+
+}
+
+
+// ------------- PARALLEL LOG REPLAY -------------
+
+ParallelLogReplay::ParallelLogReplay()
+: threads(0)
+, chunkSize(4 << 20)
+, sequentialHint(true)
+{ }
+
+ParallelLogReplay::~ParallelLogReplay()
+{ }
+
+LogReplayStats ParallelLogReplay::replay(const MappedFile& file){
+	if (sequentialHint){
+		file.advise(MappedFile::Access::Sequential);
+	}
+	return replay(file.data(), file.size());
+}
+
+LogReplayStats ParallelLogReplay::replay(const uint8_t* data, size_t size){
+	LogReplayStats stats = LogReplayStats();
+	auto start = steady_clock::now();
+
+	// chunks end right after a newline, so no sentence spans two of them and every
+	// parser starts a chunk in the state it would be in after the previous one
+	vector<size_t> ends;
+	size_t position = 0;
+	while (position < size){
+		size_t end = position + min(max<size_t>(chunkSize, 1), size - position);
+		if (end < size){
+			const void* newline = memchr(data + end - 1, '\n', size - end + 1);
+			end = (newline != nullptr) ? static_cast<const uint8_t*>(newline) + 1 - data : size;
+		}
+		ends.push_back(end);
+		position = end;
+	}
+	if (ends.empty()){
+		return stats;
+	}
+
+	size_t count = threads > 0 ? threads : max(1u, thread::hardware_concurrency());
+	count = min(count, ends.size());
+	size_t window = 2 * count;		// chunks parsed ahead of the one handed out, bounds the memory used
+
+	vector<unique_ptr<Worker>> workers;
+	for (size_t i = 0; i < count; i++){
+		workers.emplace_back(new Worker());
+		if (setup){
+			setup(workers.back()->parser, workers.back()->service);
+			workers.back()->service.publishTo(workers.back()->batch);
+		}
+	}
+
+	vector<ChunkResult> results(ends.size());
+	mutex lock;
+	condition_variable changed;
+	size_t next = 0;			// chunk to parse next
+	size_t merged = 0;			// chunks handed out
+	bool stopping = false;
+
+	auto work = [&](Worker& w){
+		while (true){
+			size_t i;
+			{
+				unique_lock<mutex> guard(lock);
+				changed.wait(guard, [&]{ return stopping || next >= ends.size() || next < merged + window; });
+				if (stopping || next >= ends.size()){
+					return;
+				}
+				i = next++;
+			}
+
+			ChunkResult& result = results[i];
+			size_t begin = (i == 0) ? 0 : ends[i - 1];
+			w.batch.result = &result;
+			w.service.date = INSDateTracker();
+			w.service.date.journal = &result.journal;
+			try {
+				parseChunk(w.parser, data + begin, ends[i] - begin, result.errors);
+			}
+			catch (...){
+				result.error = current_exception();		// the parser dropped the sentence already
+			}
+			w.service.date.journal = nullptr;
+
+			{
+				lock_guard<mutex> guard(lock);
+				result.done = true;
+			}
+			changed.notify_all();
+		}
+	};
+
+	for (auto& w : workers){
+		Worker* p = w.get();
+		w->worker = thread([&work, p]{ work(*p); });
+	}
+
+	try {
+		for (size_t i = 0; i < ends.size(); i++){
+			{
+				unique_lock<mutex> guard(lock);
+				changed.wait(guard, [&]{ return results[i].done; });
+			}
+			ChunkResult& result = results[i];
+
+			// the date tracking again, in file order
+			size_t step = 0;
+			int64_t shift = 0;		// days between the date the worker gave and the right one
+			for (size_t r = 0; r < result.records.size(); r++){
+				for (; step < result.steps[r]; step++){
+					const INSDateTracker::Step& s = result.journal[step];
+					if (s.tracked){
+						shift = date.track(s.timeOfDay) - s.day;
+					}
+					else{
+						date.setDate(s.day);
+						shift = 0;
+					}
+				}
+				INSRecord& record = result.records[r];
+				recordTime(record) += hours(24 * shift);
+				onRecord(record);
+			}
+			for (; step < result.journal.size(); step++){
+				const INSDateTracker::Step& s = result.journal[step];
+				if (s.tracked){
+					date.track(s.timeOfDay);
+				}
+				else{
+					date.setDate(s.day);
+				}
+			}
+
+			stats.bytes = ends[i];
+			stats.errors += result.errors;
+			stats.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+			exception_ptr error = result.error;
+			result = ChunkResult();
+			{
+				lock_guard<mutex> guard(lock);
+				merged = i + 1;
+			}
+			changed.notify_all();
+
+			if (error){
+				rethrow_exception(error);
+			}
+			onProgress(stats);
+		}
+	}
+	catch (...){
+		{
+			lock_guard<mutex> guard(lock);
+			stopping = true;
+		}
+		changed.notify_all();
+		for (auto& w : workers){
+			w->worker.join();
+		}
+		throw;
+	}
+
+	for (auto& w : workers){
+		w->worker.join();
+	}
+	return stats;
+}
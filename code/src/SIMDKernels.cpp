@@ -0,0 +1,239 @@
+/*
+ * SIMDKernels.cpp
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/SIMDKernels.h>
+#include <array>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NMEA_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace nmea {
+
+
+// --------- SCALAR --------------
+
+static bool validParamByte(uint8_t c){
+	return (c >= '+' && c <= '.')			// '+' ',' '-' '.'
+		|| (c >= '0' && c <= '9')
+		|| ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+static uint8_t xorScalar(const char* data, size_t size){
+	uint8_t checksum = 0;
+	for (size_t i = 0; i < size; i++){
+		checksum ^= (uint8_t)data[i];
+	}
+	return checksum;
+}
+
+static size_t invalidParamScalar(const char* data, size_t size){
+	for (size_t i = 0; i < size; i++){
+		if (!validParamByte((uint8_t)data[i])){
+			return i;
+		}
+	}
+	return size;
+}
+
+// 8 bytes at a time with 8 tables (slicing by 8)
+static const uint32_t CRC32CPolynomial = 0x82F63B78;		// reversed
+
+static const array<array<uint32_t, 256>, 8> crcTables = []{
+	array<array<uint32_t, 256>, 8> tables{};
+	for (uint32_t i = 0; i < 256; i++){
+		uint32_t crc = i;
+		for (int k = 0; k < 8; k++){
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32CPolynomial : 0);
+		}
+		tables[0][i] = crc;
+	}
+	for (uint32_t i = 0; i < 256; i++){
+		for (int t = 1; t < 8; t++){
+			tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+		}
+	}
+	return tables;
+}();
+
+static uint32_t crcScalar(const uint8_t* data, size_t size, uint32_t crc){
+	const auto& t = crcTables;
+	for (; size >= 8; size -= 8, data += 8){
+		uint32_t lo = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+		crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+			^ t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+	}
+	for (; size > 0; size--, data++){
+		crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xFF];
+	}
+	return crc;
+}
+
+
+#ifdef NMEA_X86_KERNELS
+
+// --------- SSE2 --------------
+
+// lo <= x <= hi as unsigned bytes
+__attribute__((target("sse2")))
+static inline __m128i inRange128(__m128i x, char lo, char hi){
+	return _mm_cmpeq_epi8(_mm_max_epu8(x, _mm_set1_epi8(lo)), _mm_min_epu8(x, _mm_set1_epi8(hi)));
+}
+
+__attribute__((target("sse2")))
+static inline __m128i validParam128(__m128i x){
+	__m128i lower = _mm_or_si128(x, _mm_set1_epi8(0x20));
+	return _mm_or_si128(_mm_or_si128(inRange128(x, '+', '.'), inRange128(x, '0', '9')), inRange128(lower, 'a', 'z'));
+}
+
+__attribute__((target("sse2")))
+static uint8_t fold128(__m128i acc){
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+	acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+	return (uint8_t)_mm_cvtsi128_si32(acc);
+}
+
+__attribute__((target("sse2")))
+static uint8_t xorSSE2(const char* data, size_t size){
+	__m128i acc = _mm_setzero_si128();
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16){
+		acc = _mm_xor_si128(acc, _mm_loadu_si128((const __m128i*)(data + i)));
+	}
+	return fold128(acc) ^ xorScalar(data + i, size - i);
+}
+
+__attribute__((target("sse2")))
+static size_t invalidParamSSE2(const char* data, size_t size){
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16){
+		uint32_t valid = (uint32_t)_mm_movemask_epi8(validParam128(_mm_loadu_si128((const __m128i*)(data + i))));
+		if (valid != 0xFFFF){
+			return i + __builtin_ctz(~valid);
+		}
+	}
+	return i + invalidParamScalar(data + i, size - i);
+}
+
+
+// --------- AVX2 --------------
+
+__attribute__((target("avx2")))
+static inline __m256i inRange256(__m256i x, char lo, char hi){
+	return _mm256_cmpeq_epi8(_mm256_max_epu8(x, _mm256_set1_epi8(lo)), _mm256_min_epu8(x, _mm256_set1_epi8(hi)));
+}
+
+__attribute__((target("avx2")))
+static uint8_t xorAVX2(const char* data, size_t size){
+	__m256i acc = _mm256_setzero_si256();
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32){
+		acc = _mm256_xor_si256(acc, _mm256_loadu_si256((const __m256i*)(data + i)));
+	}
+	__m128i half = _mm_xor_si128(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	return fold128(half) ^ xorSSE2(data + i, size - i);
+}
+
+__attribute__((target("avx2")))
+static size_t invalidParamAVX2(const char* data, size_t size){
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32){
+		__m256i x = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i lower = _mm256_or_si256(x, _mm256_set1_epi8(0x20));
+		__m256i valid = _mm256_or_si256(_mm256_or_si256(inRange256(x, '+', '.'), inRange256(x, '0', '9')), inRange256(lower, 'a', 'z'));
+		uint32_t mask = (uint32_t)_mm256_movemask_epi8(valid);
+		if (mask != 0xFFFFFFFF){
+			return i + __builtin_ctz(~mask);
+		}
+	}
+	return i + invalidParamSSE2(data + i, size - i);
+}
+
+
+
+// --------- SSE4.2 --------------
+
+__attribute__((target("sse4.2")))
+static uint32_t crcSSE42(const uint8_t* data, size_t size, uint32_t crc){
+#ifdef __x86_64__
+	uint64_t crc64 = crc;
+	for (; size >= 8; size -= 8, data += 8){
+		uint64_t word;
+		memcpy(&word, data, 8);
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = (uint32_t)crc64;
+#endif
+	for (; size > 0; size--, data++){
+		crc = _mm_crc32_u8(crc, *data);
+	}
+	return crc;
+}
+
+#endif
+
+
+// --------- DISPATCH --------------
+
+typedef uint8_t(*XorKernel)(const char*, size_t);
+typedef size_t(*CharClassKernel)(const char*, size_t);
+typedef uint32_t(*CrcKernel)(const uint8_t*, size_t, uint32_t);
+
+static XorKernel selectXorKernel(){
+#ifdef NMEA_X86_KERNELS
+	if (__builtin_cpu_supports("avx2")){
+		return xorAVX2;
+	}
+	if (__builtin_cpu_supports("sse2")){
+		return xorSSE2;
+	}
+#endif
+	return xorScalar;
+}
+
+static CharClassKernel selectCharClassKernel(){
+#ifdef NMEA_X86_KERNELS
+	if (__builtin_cpu_supports("avx2")){
+		return invalidParamAVX2;
+	}
+	if (__builtin_cpu_supports("sse2")){
+		return invalidParamSSE2;
+	}
+#endif
+	return invalidParamScalar;
+}
+
+static CrcKernel selectCrcKernel(){
+#ifdef NMEA_X86_KERNELS
+	if (__builtin_cpu_supports("sse4.2")){
+		return crcSSE42;
+	}
+#endif
+	return crcScalar;
+}
+
+uint8_t xorChecksum(const char* data, size_t size){
+	static const XorKernel kernel = selectXorKernel();
+	return kernel(data, size);
+}
+
+size_t findInvalidParamChar(const char* data, size_t size){
+	static const CharClassKernel kernel = selectCharClassKernel();
+	return kernel(data, size);
+}
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc){
+	static const CrcKernel kernel = selectCrcKernel();
+	return ~kernel(static_cast<const uint8_t*>(data), size, ~crc);
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+ * check.h
+ *
+ *  Checks for the test programs of this directory. Each test is a main that
+ *  returns non-zero when one of its checks failed, see run_tests.sh.
+ *
+ *  See the license file included with this source.
+ */
+
+#ifndef NMEA_TEST_CHECK_H_
+#define NMEA_TEST_CHECK_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+
+inline int checkFailures = 0;
+
+#define CHECK(condition) do {	\
+	if (!(condition)){	\
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);	\
+		checkFailures++;	\
+	}	\
+} while (0)
+
+// A file name in the temporary directory, for tests writing files
+inline std::string tempPath(const char* name){
+	const char* dir = std::getenv("TMPDIR");
+	return std::string((dir != nullptr && *dir != 0) ? dir : "/tmp") + "/nmea_" + name;
+}
+
+// Prints the outcome, returns the exit code of the test
+inline int checkResult(const char* test){
+	std::printf("%s: %s\n", test, checkFailures == 0 ? "ok" : "FAILED");
+	return checkFailures == 0 ? 0 : 1;
+}
+
+#endif /* NMEA_TEST_CHECK_H_ */
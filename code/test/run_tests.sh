@@ -0,0 +1,39 @@
+#!/bin/sh
+# Builds the sources of ../src once and every test_*.cpp of this directory against
+# them, then runs the tests. The headers are included as <nmeaparse/...>, a link to
+# ../include gives them that path.
+#
+#	code/test/run_tests.sh [test_name...]
+#
+# CXX, CXXFLAGS and BUILD_DIR (default code/test/build) can be set in the environment.
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+build=${BUILD_DIR:-$here/build}
+cxx=${CXX:-c++}
+flags=${CXXFLAGS:--O2 -Wall}
+
+mkdir -p "$build/include" "$build/obj"
+ln -sfn "$here/../include" "$build/include/nmeaparse"
+
+objects=""
+for source in "$here"/../src/*.cpp; do
+	name=$(basename "$source" .cpp)
+	case "$name" in *_demo) continue ;; esac
+	if [ ! -f "$build/obj/$name.o" ] || [ -n "$(find "$here/../src" "$here/../include" -newer "$build/obj/$name.o" -name '*.[ch]*' | head -n 1)" ]; then
+		$cxx -std=c++17 $flags -I"$build/include" -c "$source" -o "$build/obj/$name.o"
+	fi
+	objects="$objects $build/obj/$name.o"
+done
+
+tests="$*"
+if [ -z "$tests" ]; then
+	tests=$(cd "$here" && ls test_*.cpp | sed 's/\.cpp$//')
+fi
+
+failed=0
+for test in $tests; do
+	$cxx -std=c++17 $flags -I"$build/include" "$here/$test.cpp" $objects -o "$build/$test" -pthread
+	"$build/$test" || failed=1
+done
+exit $failed
@@ -0,0 +1,261 @@
+/*
+ * test_columns.cpp
+ *
+ *  INSBatchParser: the rows decoded in place, and those of the lines left to the parser,
+ *  against the records INSService reads from the same lines.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSColumns.h>
+#include <nmeaparse/INSService.h>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static string sentence(const string& body){
+	char checksum[8];
+	snprintf(checksum, sizeof(checksum), "*%02X\r\n", NMEAParser::calculateChecksum(body));
+	return "$" + body + checksum;
+}
+
+static string timeText(int64_t ms){
+	ms %= 86400000;
+	char time[32];
+	snprintf(time, sizeof(time), "%02d%02d%02d.%03d", (int)(ms / 3600000), (int)(ms / 60000 % 60), (int)(ms / 1000 % 60), (int)(ms % 1000));
+	return time;
+}
+
+// Every kind of line, good and bad, over midnight
+static string makeLog(){
+	string log;
+	int64_t ms = (23 * 3600 + 59 * 60) * 1000LL;
+	for (int i = 0; i < 400; i++, ms += 500){
+		string t = timeText(ms);
+		string h = to_string(i % 360) + ".25";
+		string aipov = "AIPOV," + t + "," + h + ",-5.353,60.563,-4.256,25.032,-62.889,24.275,66.248,4.173,43.425,30.854,"
+			"-78.474,46.481,16.398,-35.772,-84.418,65.795,-4.905,39.388,E0F9E038";
+		string pashr = "PASHR," + t + "," + h + ",T,1.2,-3.4,0.5,0.1,0.1,0.2," + to_string(i % 2) + ",0";
+		string phoct = "PHOCT,01," + t + ",T,03," + h + ",T,+1.000,T,-4.000,T,+0.100,T,+0.1,+0.2,+0.3,-0.1,-0.2,-0.3,+1.00";
+
+		switch (i % 10){
+		case 0:		// plain
+			log += sentence(aipov) + sentence(pashr) + sentence(phoct);
+			break;
+		case 1:		// '+' signs
+			log += sentence("AIPOV," + t + ",+" + h + ",+5.353,60.563,-4.256,25.032,-62.889,24.275,66.248,4.173,+43.425,30.854,"
+				"-78.474,46.481,16.398,-35.772,-84.418,65.795,-4.905,+39.388,E0F9E038");
+			log += sentence("PASHR," + t + ",+" + h + ",T,+1.2,-3.4,+0.5,0.1,0.1,0.2,1,0") + sentence(phoct);
+			break;
+		case 2:		// missing fields
+			log += sentence(aipov.substr(0, aipov.rfind(',')));
+			log += sentence(pashr.substr(0, pashr.rfind(',')));
+			log += sentence(phoct.substr(0, phoct.rfind(',')));
+			break;
+		case 3:{	// bad checksums
+			string a = sentence(aipov), p = sentence(pashr), o = sentence(phoct);
+			a[a.size() - 3] ^= 1;
+			p[p.size() - 4] ^= 2;
+			o[o.size() - 3] = (o[o.size() - 3] == 'F') ? '0' : 'F';
+			log += a + p + o;
+			break;
+		}
+		case 4:		// empty and bad numbers
+			log += sentence("AIPOV," + t + "," + h + ",,60.563,-4.256,25.032,-62.889,24.275,66.248,4.173,43.425,30.854,"
+				"-78.474,46.481,16.398,-35.772,-84.418,65.795,-4.905,39.388,E0F9E038");
+			log += sentence("PASHR," + t + ",abc,T,1.2,-3.4,0.5,0.1,0.1,0.2,1,0");
+			log += sentence("PHOCT,01," + t + ",T,03," + h + ",T,+1.000,T,-4.000,T,+0.100,T,+0.1,+0.2,1e,-0.1,-0.2,-0.3,+1.00");
+			break;
+		case 5:		// no checksum, other sentences in between
+			log += "$" + aipov + "\r\n" + sentence("GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,") + sentence(pashr);
+			log += sentence(phoct) + "$" + pashr + "\n";
+			break;
+		case 6:		// ZDA, a bad one, then the right date
+			log += sentence("GPZDA," + t + ",01,13,2025,00,00");
+			log += sentence("GPZDA," + t + "," + (ms < 86400000 ? "31,12,2024" : "01,01,2025") + ",00,00");
+			log += sentence(pashr);
+			break;
+		default:
+			log += sentence(aipov) + sentence(pashr) + sentence(phoct) + sentence(pashr);
+			break;
+		}
+	}
+	return log;
+}
+
+// Same lines, none of them plain: a space after the '$' makes the batch parser give them
+// to its NMEAParser, which drops it.
+static string notPlain(const string& log){
+	string out;
+	for (char c : log){
+		out += c;
+		if (c == '$'){
+			out += ' ';
+		}
+	}
+	return out;
+}
+
+struct Records {
+	vector<AIPOVRecord> aipov;
+	vector<TECHSASRecord> techsas;
+	vector<IXSEA_TAHRecord> ixsea_tah;
+	uint64_t errors;
+};
+
+static Records readWithService(const string& log, const INSDateTracker& start){
+	NMEAParser parser;
+	INSService service(parser);
+	service.date = start;
+	Records records;
+	records.errors = 0;
+	service.onAIPOV += [&records](const AIPOVRecord& r){ records.aipov.push_back(r); };
+	service.onTECHSAS += [&records](const TECHSASRecord& r){ records.techsas.push_back(r); };
+	service.onIXSEA_TAH += [&records](const IXSEA_TAHRecord& r){ records.ixsea_tah.push_back(r); };
+
+	const uint8_t* b = (const uint8_t*)log.data();
+	uint32_t left = (uint32_t)log.size();
+	while (left > 0){
+		uint32_t consumed;
+		NMEAParseResult result = parser.tryReadBuffer(b, left, consumed);
+		if (result){
+			break;
+		}
+		records.errors++;
+		b += consumed;
+		left -= consumed;
+	}
+	return records;
+}
+
+template <class Columns>
+static void readColumns(const string& log, const INSDateTracker& start, Columns& columns){
+	INSBatchParser batch;
+	batch.date = start;
+	size_t position = 0;
+	while (position < log.size()){
+		size_t consumed = batch.parseBatch((const uint8_t*)log.data() + position, min<size_t>(log.size() - position, 3000), columns);
+		CHECK(consumed > 0);
+		position += consumed;
+	}
+}
+
+static bool same(double a, double b){
+	return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+template <class T>
+static bool sameColumn(const vector<T>& a, const vector<T>& b, size_t size){
+	for (size_t i = 0; i < size; i++){
+		if (!same((double)a[i], (double)b[i])){
+			return false;
+		}
+	}
+	return true;
+}
+
+static int64_t ns(INSTimestamp::TimePoint t){
+	return t.time_since_epoch().count();
+}
+
+static void aipov(const string& log, const INSDateTracker& start, const Records& records){
+	AIPOVColumns plain(4096), parsed(4096);
+	readColumns(log, start, plain);
+	readColumns(notPlain(log), start, parsed);
+
+	CHECK(plain.size > 350 && parsed.size == plain.size && plain.validCount() < plain.size);
+	CHECK(plain.valid == parsed.valid);
+	CHECK(sameColumn(plain.time, parsed.time, plain.size) && sameColumn(plain.heading, parsed.heading, plain.size)
+		&& sameColumn(plain.roll, parsed.roll, plain.size) && sameColumn(plain.true_course, parsed.true_course, plain.size)
+		&& sameColumn(plain.user_status, parsed.user_status, plain.size));
+
+	// the valid rows are the records of the service
+	CHECK(plain.validCount() == records.aipov.size());
+	size_t k = 0;
+	bool equal = true;
+	for (size_t row = 0; row < plain.size && k < records.aipov.size(); row++){
+		if (!plain.isValid(row)){
+			continue;
+		}
+		const AIPOVRecord& r = records.aipov[k++];
+		equal = equal && plain.time[row] == ns(r.time) && plain.heading[row] == r.heading && plain.roll[row] == r.roll
+			&& plain.pitch[row] == r.pitch && plain.latitude[row] == r.latitude && plain.longitude[row] == r.longitude
+			&& plain.altitude[row] == r.altitude && plain.down_velocity_xv3[row] == r.down_velocity_xv3
+			&& plain.true_course[row] == r.true_course && plain.user_status[row] == r.user_status.bits;
+	}
+	CHECK(equal);
+}
+
+static void techsas(const string& log, const INSDateTracker& start, const Records& records){
+	TECHSASColumns plain(4096), parsed(4096);
+	readColumns(log, start, plain);
+	readColumns(notPlain(log), start, parsed);
+
+	CHECK(plain.size > 400 && parsed.size == plain.size);
+	CHECK(plain.valid == parsed.valid);
+	CHECK(sameColumn(plain.time, parsed.time, plain.size) && sameColumn(plain.heading, parsed.heading, plain.size)
+		&& sameColumn(plain.heave, parsed.heave, plain.size) && sameColumn(plain.x, parsed.x, plain.size));
+
+	CHECK(plain.validCount() == records.techsas.size());
+	size_t k = 0;
+	bool equal = true;
+	for (size_t row = 0; row < plain.size && k < records.techsas.size(); row++){
+		if (!plain.isValid(row)){
+			continue;
+		}
+		const TECHSASRecord& r = records.techsas[k++];
+		equal = equal && plain.time[row] == ns(r.time) && plain.heading[row] == r.heading && plain.roll[row] == r.roll
+			&& plain.pitch[row] == r.pitch && plain.heave[row] == r.heave
+			&& plain.heading_standard_deviation[row] == r.heading_standard_deviation
+			&& (bool)plain.true_heading[row] == r.true_heading && (bool)plain.x[row] == r.x && (bool)plain.y[row] == r.y;
+	}
+	CHECK(equal);
+}
+
+static void ixsea_tah(const string& log, const INSDateTracker& start, const Records& records){
+	IXSEA_TAHColumns plain(4096), parsed(4096);
+	readColumns(log, start, plain);
+	readColumns(notPlain(log), start, parsed);
+
+	CHECK(plain.size > 300 && parsed.size == plain.size);
+	CHECK(plain.valid == parsed.valid);
+	CHECK(sameColumn(plain.time, parsed.time, plain.size) && sameColumn(plain.true_heading, parsed.true_heading, plain.size)
+		&& sameColumn(plain.sway_speed, parsed.sway_speed, plain.size) && sameColumn(plain.latency, parsed.latency, plain.size));
+
+	CHECK(plain.validCount() == records.ixsea_tah.size());
+	size_t k = 0;
+	bool equal = true;
+	for (size_t row = 0; row < plain.size && k < records.ixsea_tah.size(); row++){
+		if (!plain.isValid(row)){
+			continue;
+		}
+		const IXSEA_TAHRecord& r = records.ixsea_tah[k++];
+		equal = equal && plain.time[row] == ns(r.time) && plain.protocol_version_id[row] == r.protocol_version_id
+			&& plain.latency[row] == r.latency && plain.true_heading[row] == r.true_heading && plain.roll[row] == r.roll
+			&& plain.heave[row] == r.heave && plain.heading_rate[row] == r.heading_rate
+			&& plain.utc_time_status[row] == r.utc_time_status && plain.true_heading_status[row] == r.true_heading_status;
+	}
+	CHECK(equal);
+}
+
+int main(){
+	string log = makeLog();
+	INSDateTracker start;
+	start.setDate(2024, 12, 31);
+	Records records = readWithService(log, start);
+	CHECK(records.errors > 100);
+	CHECK(!records.aipov.empty() && !records.techsas.empty() && !records.ixsea_tah.empty());
+	CHECK(records.techsas.back().time - records.techsas.front().time > seconds(150));
+
+	aipov(log, start, records);
+	techsas(log, start, records);
+	ixsea_tah(log, start, records);
+	return checkResult("test_columns");
+}
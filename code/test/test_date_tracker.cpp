@@ -0,0 +1,115 @@
+/*
+ * test_date_tracker.cpp
+ *
+ *  INSDateTracker: midnight, late sentences from before it, and gaps in the recording.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSFix.h>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static const int64_t Dec31 = 20088;		// Dec 31, 2024, as days since Jan 1, 1970
+
+static nanoseconds at(int h, int m, double s){
+	return hours(h) + minutes(m) + nanoseconds((int64_t)(s * 1e9));
+}
+
+static void midnight(){
+	INSDateTracker date;
+	date.setDate(2024, 12, 31);
+	CHECK(date.track(at(23, 59, 59.5)) == Dec31);
+	CHECK(date.track(at(0, 0, 0.5)) == Dec31 + 1);
+	CHECK(date.track(at(0, 0, 1)) == Dec31 + 1);
+
+	// a few late sentences from before midnight keep their day
+	CHECK(date.track(at(23, 59, 59.9)) == Dec31);
+	CHECK(date.track(at(23, 59, 59.95)) == Dec31);
+	CHECK(date.track(at(0, 0, 1.5)) == Dec31 + 1);
+
+	// and the next midnight is still seen
+	CHECK(date.track(at(12, 0, 0)) == Dec31 + 1);
+	CHECK(date.track(at(23, 0, 0)) == Dec31 + 1);
+	CHECK(date.track(at(0, 0, 2)) == Dec31 + 2);
+
+	INSTimestamp timestamp;
+	timestamp.hour = 0;
+	timestamp.min = 0;
+	timestamp.sec = 3;
+	timestamp.microsec = 0;
+	timestamp.nanosec = 0;
+	date.track(timestamp);
+	CHECK(timestamp.year == 2025 && timestamp.month == 1 && timestamp.day == 2);
+}
+
+static void gap(){
+	// the recorder is paused from 06:00 to 19:00, the same day, the date goes on from there
+	INSDateTracker date;
+	date.setDate(Dec31);
+	CHECK(date.track(at(6, 0, 0)) == Dec31);
+
+	bool same = true;
+	nanoseconds t = at(19, 0, 0);
+	for (int i = 0; i < 100; i++, t += milliseconds(40)){
+		same = same && date.track(t) == Dec31;
+	}
+	CHECK(same);
+	CHECK(date.track(at(23, 59, 59)) == Dec31);
+	CHECK(date.track(at(0, 0, 1)) == Dec31 + 1);
+
+	// paused from just after midnight to just before the next one
+	CHECK(date.track(at(0, 0, 30)) == Dec31 + 1);
+	t = at(23, 59, 50);
+	same = true;
+	for (uint32_t i = 0; i < date.maxLateSentences; i++, t += milliseconds(40)){
+		same = same && date.track(t) == Dec31;		// taken for late ones, the day before
+	}
+	CHECK(same);
+	same = true;
+	for (int i = 0; i < 100; i++, t += milliseconds(40)){
+		same = same && date.track(t) == Dec31 + 1;		// more of them, the recording went on
+	}
+	CHECK(same);
+	CHECK(date.track(at(0, 0, 1)) == Dec31 + 2);
+
+	// further from midnight than maxLateness, a gap from the start
+	date.setDate(Dec31);
+	CHECK(date.track(at(0, 0, 10)) == Dec31);
+	CHECK(date.track(at(23, 58, 0)) == Dec31);
+	CHECK(date.track(at(23, 58, 1)) == Dec31);
+}
+
+static void lateRun(){
+	// a run of late sentences no longer than maxLateSentences, between sentences of the day
+	INSDateTracker date;
+	date.setDate(Dec31);
+	CHECK(date.track(at(0, 0, 1)) == Dec31);
+	for (int round = 0; round < 3; round++){
+		for (uint32_t i = 0; i < date.maxLateSentences; i++){
+			CHECK(date.track(at(23, 59, 59)) == Dec31 - 1);
+		}
+		CHECK(date.track(at(0, 0, 2 + round)) == Dec31);
+	}
+}
+
+static void setDateRestarts(){
+	INSDateTracker date;
+	date.setDate(Dec31);
+	CHECK(date.track(at(22, 0, 0)) == Dec31);
+	date.setDate(2025, 1, 1);
+	CHECK(date.track(at(1, 0, 0)) == Dec31 + 1);		// not a new day, the date was set
+	CHECK(date.track(at(2, 0, 0)) == Dec31 + 1);
+}
+
+int main(){
+	midnight();
+	gap();
+	lateRun();
+	setDateRestarts();
+	return checkResult("test_date_tracker");
+}
@@ -0,0 +1,205 @@
+/*
+ * test_event.cpp
+ *
+ *  Event: handlers added or removed while the event is being called, handler IDs, and
+ *  where EventCallable keeps its callable.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/Event.h>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+typedef Event<void(vector<string>&)> Trace;
+
+// Removed handlers are not called anymore, even later in the same call
+static void removeWhileCalling(){
+	Trace event;
+	EventHandler<void(vector<string>&)> b([](vector<string>& t){ t.push_back("b"); });
+	EventHandler<void(vector<string>&)> c([](vector<string>& t){ t.push_back("c"); });
+	uint64_t self = 0;
+	event += [&](vector<string>& t){
+		t.push_back("a");
+		event -= c;
+	};
+	event += b;
+	self = event.registerHandler([&](vector<string>& t){
+		t.push_back("self");
+		CHECK(event.removeHandler(self));
+		CHECK(!event.removeHandler(self));
+	}).getID();
+	event += c;
+	CHECK(event.size() == 4);
+
+	vector<string> trace;
+	event(trace);
+	CHECK((trace == vector<string>{ "a", "b", "self" }));
+	CHECK(event.size() == 2);
+
+	trace.clear();
+	event(trace);
+	CHECK((trace == vector<string>{ "a", "b" }));
+
+	// clear from a handler stops the call
+	Trace cleared;
+	cleared += [&cleared](vector<string>& t){ t.push_back("x"); cleared.clear(); };
+	cleared += [](vector<string>& t){ t.push_back("y"); };
+	trace.clear();
+	cleared(trace);
+	cleared(trace);
+	CHECK((trace == vector<string>{ "x" }) && cleared.empty());
+}
+
+// Added handlers are called from the next call on, also when the call is nested
+static void addWhileCalling(){
+	Trace event;
+	int depth = 0;
+	event += [&](vector<string>& t){
+		t.push_back("a" + to_string(depth));
+		if (depth == 0){
+			event += [](vector<string>& t){ t.push_back("added"); };
+			depth++;
+			event(t);
+			depth--;
+		}
+	};
+	event += [&](vector<string>& t){ t.push_back("b" + to_string(depth)); };
+
+	vector<string> trace;
+	event(trace);
+	CHECK((trace == vector<string>{ "a0", "a1", "b1", "b0" }));
+	CHECK(event.size() == 3);		// one more every outer call
+
+	trace.clear();
+	event(trace);
+	CHECK((trace == vector<string>{ "a0", "a1", "b1", "added", "b0", "added" }));
+	CHECK(event.size() == 4);
+
+	// added then removed in the same call, never called
+	Trace quick;
+	quick += [&quick](vector<string>& t){
+		t.push_back("a");
+		auto h = quick += [](vector<string>& t){ t.push_back("never"); };
+		CHECK(quick -= h);
+	};
+	trace.clear();
+	quick(trace);
+	quick(trace);
+	CHECK((trace == vector<string>{ "a", "a" }) && quick.size() == 1);
+}
+
+// IDs are unique and never 0, a handler is registered once, and may come back once removed
+static void handlerIDs(){
+	Trace event;
+	EventHandler<void(vector<string>&)> h([](vector<string>& t){ t.push_back("h"); });
+	EventHandler<void(vector<string>&)> other([](vector<string>& t){ t.push_back("other"); });
+	EventHandler<void(vector<string>&)> copy = h;
+	CHECK(h.getID() != 0 && h.getID() != other.getID());
+	CHECK(copy == h && copy.getID() == h.getID());
+
+	event += h;
+	event += copy;		// same handler
+	CHECK(event.size() == 1);
+	CHECK(!event.removeHandler(0));
+	CHECK(!event.removeHandler(other));
+
+	// removed and added back during a call: once, at the end, called from the next call on
+	event += [&](vector<string>& t){
+		t.push_back("remove and add h");
+		event -= h;
+		event += h;
+		event += h;
+	};
+	vector<string> trace;
+	event(trace);
+	CHECK((trace == vector<string>{ "h", "remove and add h" }) && event.size() == 2);
+	trace.clear();
+	event(trace);
+	CHECK((trace == vector<string>{ "remove and add h" }) && event.size() == 2);
+	trace.clear();
+	event(trace);
+	CHECK((trace == vector<string>{ "remove and add h" }) && event.size() == 2);
+
+	// a copy of the event has the same handlers, removing one from the copy leaves the event alone
+	Trace copied = event;
+	CHECK(copied.size() == 2);
+	CHECK(copied -= h);
+	CHECK(event.size() == 2 && copied.size() == 1);
+
+	CHECK(event -= h.getID());
+	CHECK(!(event -= h.getID()));
+	event.clear();
+	event += h;
+	CHECK(event.size() == 1);
+}
+
+static void plainFunction(int& n){
+	n++;
+}
+
+// Small callables are stored in place, bigger ones on the heap, copies and destruction
+// go through the same storage
+static void storage(){
+	typedef EventCallable<void(int&)> Callable;
+	shared_ptr<int> owner = make_shared<int>(0);
+
+	auto small = [owner](int& n){ n += 1 + *owner; };
+	array<char, Callable::InlineSize> padding = {};
+	auto big = [owner, padding](int& n){ n += 2 + padding[0]; };
+	CHECK(sizeof(small) <= Callable::InlineSize && sizeof(big) > Callable::InlineSize);
+	const long users = owner.use_count();
+	{
+		Callable inlined(small), allocated(big);
+		CHECK(owner.use_count() == users + 2);
+		const char* begin = reinterpret_cast<const char*>(&inlined);
+		const char* at = reinterpret_cast<const char*>(inlined.target<decltype(small)>());
+		CHECK(at >= begin && at < begin + sizeof(Callable));
+		begin = reinterpret_cast<const char*>(&allocated);
+		at = reinterpret_cast<const char*>(allocated.target<decltype(big)>());
+		CHECK(at != nullptr && (at < begin || at >= begin + sizeof(Callable)));
+		CHECK(inlined.target<decltype(big)>() == nullptr && allocated.target<decltype(small)>() == nullptr);
+
+		Callable copies[] = { inlined, allocated };
+		CHECK(owner.use_count() == users + 4);
+		CHECK(copies[1].target<decltype(big)>() != allocated.target<decltype(big)>());
+		copies[0] = copies[1];
+		copies[1] = inlined;
+		CHECK(owner.use_count() == users + 4);
+
+		int n = 0;
+		inlined(n);
+		allocated(n);
+		copies[0](n);
+		copies[1](n);
+		CHECK(n == 6);
+
+		inlined.reset();
+		CHECK(!inlined && owner.use_count() == users + 3);
+	}
+	CHECK(owner.use_count() == users);
+
+	// function pointers, given as such or through a std::function
+	EventHandler<void(int&)> pointer(&plainFunction);
+	function<void(int&)> f = &plainFunction;
+	EventHandler<void(int&)> wrapped(f);
+	EventHandler<void(int&)> lambda([](int& n){ n++; });
+	CHECK(pointer.getFunctionPointer() != nullptr && *pointer.getFunctionPointer() == &plainFunction);
+	CHECK(wrapped.getFunctionPointer() != nullptr && *wrapped.getFunctionPointer() == &plainFunction);
+	CHECK(lambda.getFunctionPointer() == nullptr);
+}
+
+int main(){
+	removeWhileCalling();
+	addWhileCalling();
+	handlerIDs();
+	storage();
+	return checkResult("test_event");
+}
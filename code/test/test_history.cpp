@@ -0,0 +1,145 @@
+/*
+ * test_history.cpp
+ *
+ *  INSHistory: queries on a sample, between two samples, across the 0/360 wrap and out of
+ *  the range kept.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSHistory.h>
+#include <cmath>
+#include <random>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static INSTimestamp::TimePoint at(int64_t ms){
+	return INSTimestamp::TimePoint(milliseconds(1700000000000LL + ms));
+}
+
+static INSPose pose(int64_t ms, double heading, double roll = 0, double pitch = 0, double longitude = 0){
+	return INSPose{ at(ms), 45.0, longitude, -10.0, heading, roll, pitch };
+}
+
+static bool near(double a, double b){
+	return fabs(a - b) < 1e-9;
+}
+
+static bool inRange(const INSPose& p){
+	return p.heading >= 0 && p.heading < 360 && p.roll >= -180 && p.roll < 180
+		&& p.longitude >= -180 && p.longitude < 180;
+}
+
+static void exactHit(){
+	INSHistory history;
+	history.reset(16);
+	for (int i = 0; i < 10; i++){
+		CHECK(history.push(pose(i * 100, 10.0 * i + 0.123, 1.5 * i, -0.5 * i, 2.0 * i)));
+	}
+	INSPose p;
+	for (int i = 0; i < 10; i++){
+		for (INSInterpolation interpolation : { INSInterpolation::Linear, INSInterpolation::Slerp }){
+			CHECK(history.query(at(i * 100), p, interpolation));
+			CHECK(p.time == at(i * 100) && p.heading == 10.0 * i + 0.123 && p.roll == 1.5 * i
+				&& p.pitch == -0.5 * i && p.longitude == 2.0 * i);
+		}
+	}
+	CHECK(history.latest(p) && p.time == at(900));
+	CHECK(!history.push(pose(900, 0)));		// not newer than the last one
+}
+
+static void bracketed(){
+	INSHistory history;
+	history.reset(16);
+	history.push(INSPose{ at(0), 10.0, 20.0, 100.0, 30.0, 2.0, -4.0 });
+	history.push(INSPose{ at(1000), 11.0, 22.0, 110.0, 40.0, 4.0, -2.0 });
+
+	INSPose p;
+	CHECK(history.query(at(250), p, INSInterpolation::Linear));
+	CHECK(p.time == at(250));
+	CHECK(near(p.latitude, 10.25) && near(p.longitude, 20.5) && near(p.altitude, 102.5));
+	CHECK(near(p.heading, 32.5) && near(p.roll, 2.5) && near(p.pitch, -3.5));
+
+	// small angles, the rotation goes about the same way
+	CHECK(history.query(at(250), p, INSInterpolation::Slerp));
+	CHECK(fabs(p.heading - 32.5) < 0.05 && fabs(p.roll - 2.5) < 0.05 && fabs(p.pitch + 3.5) < 0.05);
+	CHECK(near(p.latitude, 10.25));
+}
+
+static void wrapAround(){
+	// the short way across 0/360 and +/-180, never 360 or 180 itself
+	INSHistory history;
+	history.reset(4);
+	history.push(pose(0, 359.0, 179.0, 0.0, 179.0));
+	history.push(pose(1000, 1.0, -179.0, 0.0, -179.0));
+
+	INSPose p;
+	CHECK(history.query(at(500), p, INSInterpolation::Linear));
+	CHECK(near(p.heading, 0) && near(p.roll, -180) && near(p.longitude, -180));
+	CHECK(inRange(p));
+	CHECK(history.query(at(250), p, INSInterpolation::Linear));
+	CHECK(near(p.heading, 359.5) && near(p.longitude, 179.5));
+
+	history.reset(4);
+	history.push(pose(0, 359.0));
+	history.push(pose(1000, 1.0));
+	CHECK(history.query(at(500), p, INSInterpolation::Slerp));
+	CHECK(inRange(p));
+	CHECK(fabs(p.heading) < 1e-6 || fabs(p.heading - 360) < 1e-6);
+	CHECK(history.query(at(750), p, INSInterpolation::Slerp));
+	CHECK(fabs(p.heading - 0.5) < 1e-4);		// close samples, normalized lerp
+
+	// any pair, any time between them
+	mt19937 random(5);
+	uniform_real_distribution<double> angle(-1e-9, 1e-9);
+	bool all = true;
+	for (int i = 0; i < 20000; i++){
+		double h = (random() % 2) ? 360 - (random() % 3) * 1e-12 : (random() % 3) * 1e-12;
+		history.reset(4);
+		history.push(pose(0, fmod(h + 359.0 + angle(random), 360), 180 - 1e-13, angle(random), 180 - 1e-13));
+		history.push(pose(1000, fmod(h + 1.0 + angle(random), 360), -180 + 1e-13, angle(random), -180));
+		for (INSInterpolation interpolation : { INSInterpolation::Linear, INSInterpolation::Slerp }){
+			all = all && history.query(at(1 + random() % 999), p, interpolation) && inRange(p);
+			all = all && history.query(at(500), p, interpolation) && inRange(p);
+		}
+	}
+	CHECK(all);
+}
+
+static void outOfRange(){
+	INSHistory history;
+	INSPose p;
+	CHECK(!history.push(pose(0, 0)));		// no capacity yet
+	CHECK(!history.query(at(0), p));
+
+	history.reset(4, milliseconds(1500));
+	CHECK(!history.query(at(0), p));		// empty
+	for (int i = 0; i < 10; i++){
+		history.push(pose(i * 1000, i));
+	}
+	CHECK(!history.query(at(10000), p));	// after the newest
+	CHECK(!history.query(at(5500), p));		// overwritten, only the last 4 are kept
+	CHECK(!history.query(at(7500), p));		// kept, but older than maxAge
+	CHECK(history.query(at(8500), p, INSInterpolation::Linear) && near(p.heading, 8.5));
+	CHECK(history.query(at(9000), p) && p.heading == 9);
+
+	history.reset(4);		// no maxAge, the whole capacity
+	for (int i = 0; i < 10; i++){
+		history.push(pose(i * 1000, i));
+	}
+	CHECK(!history.query(at(5999), p));
+	CHECK(history.query(at(6000), p) && p.heading == 6);
+	CHECK(history.query(at(6500), p, INSInterpolation::Linear) && near(p.heading, 6.5));
+}
+
+int main(){
+	exactHit();
+	bracketed();
+	wrapAround();
+	outOfRange();
+	return checkResult("test_history");
+}
@@ -0,0 +1,100 @@
+/*
+ * test_kernels.cpp
+ *
+ *  SIMDKernels against plain loops, on every length and alignment around the vector widths.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/SIMDKernels.h>
+#include <random>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+static uint32_t crcBitwise(const uint8_t* data, size_t size, uint32_t crc){
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++){
+		crc ^= data[i];
+		for (int k = 0; k < 8; k++){
+			crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+		}
+	}
+	return ~crc;
+}
+
+static bool validParamChar(uint8_t c){
+	return c == '+' || c == ',' || c == '-' || c == '.'
+		|| (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static void crcCheckValues(){
+	CHECK(crc32c("123456789", 9) == 0xE3069283);
+	CHECK(crc32c("", 0) == 0);
+	CHECK(crc32c("6789", 4, crc32c("12345", 5)) == 0xE3069283);
+
+	vector<uint8_t> zeros(32, 0), ones(32, 0xFF);
+	CHECK(crc32c(zeros.data(), zeros.size()) == 0x8A9136AA);		// RFC 3720, B.4
+	CHECK(crc32c(ones.data(), ones.size()) == 0x62A8AB43);
+}
+
+static void crcRandom(){
+	mt19937 random(1);
+	vector<uint8_t> data(4096 + 64);
+	for (uint8_t& b : data){
+		b = (uint8_t)random();
+	}
+	for (size_t offset = 0; offset < 16; offset++){
+		for (size_t size = 0; size < 300; size++){
+			CHECK(crc32c(data.data() + offset, size) == crcBitwise(data.data() + offset, size, 0));
+		}
+	}
+	// in pieces
+	uint32_t crc = 0;
+	size_t position = 0;
+	while (position < 4096){
+		size_t n = min<size_t>(4096 - position, random() % 200);
+		crc = crc32c(data.data() + position, n, crc);
+		position += n;
+	}
+	CHECK(crc == crcBitwise(data.data(), 4096, 0));
+}
+
+static void xorAndParamChars(){
+	mt19937 random(2);
+	const string allowed = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz+,-.";
+	vector<char> data(256 + 64);
+	for (size_t size = 0; size < 256; size++){
+		for (size_t offset = 0; offset < 4; offset++){
+			char* text = data.data() + offset;
+			uint8_t checksum = 0;
+			for (size_t i = 0; i < size; i++){
+				text[i] = allowed[random() % allowed.size()];
+				checksum ^= (uint8_t)text[i];
+			}
+			CHECK(xorChecksum(text, size) == checksum);
+			CHECK(findInvalidParamChar(text, size) == size);
+
+			// every byte value at every position is found, or not, like the plain loop
+			if (size > 0){
+				size_t at = random() % size;
+				for (int c = 0; c < 256; c++){
+					char saved = text[at];
+					text[at] = (char)c;
+					CHECK(findInvalidParamChar(text, size) == (validParamChar((uint8_t)c) ? size : at));
+					text[at] = saved;
+				}
+			}
+		}
+	}
+}
+
+int main(){
+	crcCheckValues();
+	crcRandom();
+	xorAndParamChars();
+	return checkResult("test_kernels");
+}
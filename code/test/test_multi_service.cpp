@@ -0,0 +1,163 @@
+/*
+ * test_multi_service.cpp
+ *
+ *  INSMultiService: everything submitted before stop is parsed, nothing after it, and the
+ *  records of each source come out complete and in order while all of them are fed at once.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSMultiService.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static const string Line = "$AIPOV,235007.0400,89.216,-5.353,60.563,-4.256,25.032,-62.889,24.275,66.248,4.173,43.425,30.854,-78.474,46.481,16.398,-35.772,-84.418,65.795,-4.905,39.388,E0F9E038*06\r\n";
+
+static void submitThenStop(OverflowPolicy overflow){
+	const uint32_t sourceCount = 4;
+	const size_t lines = 500;
+
+	for (int round = 0; round < 50; round++){
+		INSMultiService multi(2, 64, overflow);
+		vector<size_t> read(sourceCount, 0);
+		for (uint32_t id = 0; id < sourceCount; id++){
+			size_t* count = &read[id];
+			multi.addSource(id)->onAIPOV += [count](const AIPOVRecord&){ (*count)++; };
+		}
+		multi.start();
+
+		// one thread per source, each sentence in two submits
+		vector<thread> producers;
+		for (uint32_t id = 0; id < sourceCount; id++){
+			producers.emplace_back([&multi, id, lines]{
+				const uint8_t* b = (const uint8_t*)Line.data();
+				for (size_t i = 0; i < lines; i++){
+					multi.submit(id, b, 100);
+					multi.submit(id, b + 100, Line.size() - 100);
+				}
+			});
+		}
+		for (thread& t : producers){
+			t.join();
+		}
+		multi.stop();
+
+		for (uint32_t id = 0; id < sourceCount; id++){
+			CHECK(read[id] == lines);
+			CHECK(multi.errorCount(id) == 0);
+		}
+		CHECK(!multi.submit(0, (const uint8_t*)Line.data(), Line.size()));
+	}
+}
+
+static void stopWhileSubmitting(){
+	// the lines pushed before stop are parsed, whole ones as the chunks are whole lines
+	for (int round = 0; round < 50; round++){
+		INSMultiService multi(1, 16);
+		size_t read = 0;
+		multi.addSource(7)->onAIPOV += [&read](const AIPOVRecord&){ read++; };
+		multi.start();
+
+		size_t accepted = 0;
+		thread producer([&]{
+			while (multi.submit(7, (const uint8_t*)Line.data(), Line.size())){
+				accepted++;
+			}
+		});
+		this_thread::yield();
+		multi.stop();
+		producer.join();
+
+		CHECK(read == accepted);
+		CHECK(multi.errorCount(7) == 0);
+	}
+}
+
+// Line with the time and heading given, the rest as in Line
+static string aipov(uint32_t centiseconds, uint32_t heading){
+	char time[16];
+	snprintf(time, sizeof(time), "%02u%02u%02u.%02u00", centiseconds / 360000, centiseconds / 6000 % 60,
+		centiseconds / 100 % 60, centiseconds % 100);
+	string rest = Line.substr(Line.find(",-5.353"), Line.find('*') - Line.find(",-5.353"));
+	string body = "AIPOV," + string(time) + "," + to_string(heading) + ".000" + rest;
+	char checksum[4];
+	snprintf(checksum, sizeof(checksum), "%02X", NMEAParser::calculateChecksum(body));
+	return "$" + body + "*" + checksum + "\r\n";
+}
+
+static void sourcesInParallel(){
+	const uint32_t sourceCount = 8, lines = 2000;
+	INSMultiService multi(4, 64);
+
+	// written by the worker of the source's shard only
+	struct Received {
+		uint32_t id;
+		size_t count;
+		bool ordered;
+		bool ours;
+		INSTimestamp::TimePoint last;
+	};
+	vector<Received> received(sourceCount);
+	for (uint32_t i = 0; i < sourceCount; i++){
+		uint32_t id = 100 + i;
+		Received* r = &received[i];
+		*r = Received{ id, 0, true, true, INSTimestamp::TimePoint::min() };
+		multi.addSource(id)->onAIPOV += [r](const AIPOVRecord& record){
+			r->ordered = r->ordered && record.time > r->last;
+			r->ours = r->ours && record.heading == r->id;
+			r->last = record.time;
+			r->count++;
+		};
+	}
+	multi.start();
+	CHECK(multi.addSource(999) == nullptr);
+	CHECK(multi.service(999) == nullptr);
+
+	// all the sources at once, in pieces of any size
+	vector<thread> producers;
+	for (uint32_t i = 0; i < sourceCount; i++){
+		producers.emplace_back([&multi, i, lines]{
+			uint32_t id = 100 + i;
+			string text;
+			for (uint32_t k = 0; k < lines; k++){
+				text += aipov(360000 + k * 7, id);
+			}
+			mt19937 random(id);
+			size_t position = 0;
+			while (position < text.size()){
+				size_t n = min<size_t>(text.size() - position, 1 + random() % 3000);
+				multi.submit(id, (const uint8_t*)text.data() + position, n);
+				position += n;
+			}
+		});
+	}
+	for (thread& t : producers){
+		t.join();
+	}
+	multi.stop();
+
+	for (const Received& r : received){
+		CHECK(r.count == lines);
+		CHECK(r.ordered);
+		CHECK(r.ours);
+		CHECK(multi.errorCount(r.id) == 0);
+		CHECK(multi.snapshot(r.id).heading == r.id);
+	}
+	CHECK(multi.addSource(999) != nullptr);		// stopped
+}
+
+int main(){
+	submitThenStop(OverflowPolicy::Block);
+	stopWhileSubmitting();
+	sourcesInParallel();
+	return checkResult("test_multi_service");
+}
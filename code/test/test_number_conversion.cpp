@@ -0,0 +1,112 @@
+/*
+ * test_number_conversion.cpp
+ *
+ *  The from_chars fast path gives what strtod/strtoll give, on plain numbers and on
+ *  random field text.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/NumberConversion.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+static bool sameDouble(double a, double b){
+	if (std::isnan(a) || std::isnan(b)){
+		return std::isnan(a) && std::isnan(b);
+	}
+	return memcmp(&a, &b, sizeof(double)) == 0;		// -0.0 is not 0.0
+}
+
+static bool strtodField(const string& s, double& d){
+	char* p;
+	d = strtod(s.c_str(), &p);
+	return *p == 0;
+}
+
+static bool strtollField(const string& s, int64_t& d, int radix){
+	char* p;
+	d = strtoll(s.c_str(), &p, radix);
+	return *p == 0;
+}
+
+static string randomField(mt19937& random){
+	static const char alphabet[] = "0123456789012345678901234567890123456789+-.eExX aAfFn";
+	size_t size = random() % 14;
+	string s;
+	for (size_t i = 0; i < size; i++){
+		s += alphabet[random() % (sizeof(alphabet) - 1)];
+	}
+	return s;
+}
+
+static string plainNumber(mt19937& random){
+	char buffer[64];
+	double value = ldexp((double)random() / 4294967296.0 - 0.5, (int)(random() % 60) - 30);
+	switch (random() % 4){
+	case 0:		snprintf(buffer, sizeof(buffer), "%.3f", value * 360);			break;
+	case 1:		snprintf(buffer, sizeof(buffer), "%.9f", value);				break;
+	case 2:		snprintf(buffer, sizeof(buffer), "%+.6e", value);				break;
+	default:	snprintf(buffer, sizeof(buffer), "%.17g", value);				break;
+	}
+	return buffer;
+}
+
+static void doubles(){
+	mt19937 random(4);
+	bool same = true;
+	for (int i = 0; i < 1000000; i++){
+		string s = (i % 2) ? randomField(random) : plainNumber(random);
+		double expected = 0, got = 0;
+		bool ok = strtodField(s, expected);
+		bool parsed = tryParseDouble(s, got);
+		if (parsed != ok || (ok && !sameDouble(got, expected))){
+			fprintf(stderr, "tryParseDouble(\"%s\")\n", s.c_str());
+			same = false;
+		}
+	}
+	CHECK(same);
+
+	double d;
+	CHECK(tryParseDouble("-12.5", d) && d == -12.5);
+	CHECK(tryParseDouble("+0.25", d) && d == 0.25);
+	CHECK(!tryParseDouble("1.2.3", d));
+	CHECK(parseDouble("") == 0);
+}
+
+static void integers(){
+	mt19937 random(5);
+	bool same = true;
+	for (int i = 0; i < 1000000; i++){
+		string s = randomField(random);
+		int radix = (i % 3 == 0) ? 16 : 10;
+		int64_t expected = 0, got = 0;
+		bool ok = strtollField(s, expected, radix);
+		bool parsed = tryParseInt(s, got, radix);
+		if (parsed != ok || (ok && got != expected)){
+			fprintf(stderr, "tryParseInt(\"%s\", %d)\n", s.c_str(), radix);
+			same = false;
+		}
+	}
+	CHECK(same);
+
+	int64_t n;
+	CHECK(tryParseInt("3F", n, 16) && n == 0x3F);
+	CHECK(tryParseInt("-42", n) && n == -42);
+	CHECK(tryParseInt("99999999999999999999", n) && n == INT64_MAX);		// like strtoll
+	CHECK(!tryParseInt("4 2", n));
+}
+
+int main(){
+	doubles();
+	integers();
+	return checkResult("test_number_conversion");
+}
@@ -0,0 +1,151 @@
+/*
+ * test_parallel_replay.cpp
+ *
+ *  ParallelLogReplay against LogReplay: the same records, dates included, in the same
+ *  order, for a log of several days cut into chunks of any size.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/ParallelLogReplay.h>
+#include <nmeaparse/LogReplay.h>
+#include <nmeaparse/INSService.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static string sentence(const string& body){
+	char checksum[8];
+	snprintf(checksum, sizeof(checksum), "*%02X\r\n", NMEAParser::calculateChecksum(body));
+	return "$" + body + checksum;
+}
+
+// AIPOV, PASHR and PHOCT every 4 s for 60 hours from 20:00 on Dec 31 2024, dated by
+// the tracker but for one ZDA. Some sentences are late, two of them after each midnight,
+// some are damaged, and the recording stops for 5 hours on the second day.
+static string makeLog(){
+	mt19937 random(11);
+	string log;
+	int64_t start = 20 * 3600 * 1000LL;
+	for (int64_t i = 0, ms = start; ms < start + 60 * 3600 * 1000LL; i++, ms += 4000){
+		if (ms >= start + 20 * 3600 * 1000LL && ms < start + 25 * 3600 * 1000LL){
+			continue;
+		}
+		int64_t t = ms;
+		if (random() % 150 == 0){
+			t -= 20000;
+		}
+		int64_t tod = t % 86400000;
+		char time[32];
+		snprintf(time, sizeof(time), "%02d%02d%02d.%03d", (int)(tod / 3600000), (int)(tod / 60000 % 60), (int)(tod / 1000 % 60), (int)(tod % 1000));
+
+		char body[256];
+		switch (i % 3){
+		case 0:
+			snprintf(body, sizeof(body), "AIPOV,%s,%d.500,-5.353,60.563,-4.256,25.032,-62.889,24.275,66.248,4.173,43.425,30.854,"
+				"-78.474,46.481,16.398,-35.772,-84.418,65.795,-4.905,39.388,E0F9E038", time, (int)(i % 360));
+			break;
+		case 1:
+			snprintf(body, sizeof(body), "PASHR,%s,%d.00,T,1.2,-3.4,0.5,0.1,0.1,0.2,1,0", time, (int)(i % 360));
+			break;
+		default:
+			snprintf(body, sizeof(body), "PHOCT,01,%s,T,03,%d.000,T,+1.000,T,-4.000,T,+0.100,T,+0.1,+0.2,+0.3,-0.1,-0.2,-0.3,+1.00", time, (int)(i % 360));
+			break;
+		}
+		string line = sentence(body);
+		if (random() % 500 == 0){
+			line[line.size() - 4] ^= 1;		// checksum
+		}
+		log += line;
+
+		if (ms % 86400000 >= 4000 && ms % 86400000 < 12000){		// late from before midnight
+			int64_t late = (ms - 14000) % 86400000;
+			snprintf(time, sizeof(time), "%02d%02d%02d.%03d", (int)(late / 3600000), (int)(late / 60000 % 60), (int)(late / 1000 % 60), (int)(late % 1000));
+			snprintf(body, sizeof(body), "PASHR,%s,1.00,T,1.2,-3.4,0.5,0.1,0.1,0.2,1,0", time);
+			log += sentence(body);
+		}
+		if (ms == start + 30 * 3600 * 1000LL){
+			snprintf(body, sizeof(body), "GPZDA,%s,02,01,2025,00,00", time);
+			log += sentence(body);
+		}
+	}
+	return log;
+}
+
+// type, time and a value of the sentence, in order
+typedef tuple<int, int64_t, double> Key;
+
+static Key key(const INSRecord& r){
+	double value = 0;
+	switch (r.type){
+	case INSRecordType::AIPOV:		value = r.aipov.heading;			break;
+	case INSRecordType::TECHSAS:	value = r.techsas.heading;			break;
+	case INSRecordType::IXSEA_TAH:	value = r.ixsea_tah.true_heading;	break;
+	default:						break;
+	}
+	return Key((int)r.type, r.time().time_since_epoch().count(), value);
+}
+
+struct Records {
+	vector<Key> all;
+	void push(const INSRecord& record){
+		all.push_back(key(record));
+	}
+};
+
+static void sameAsSequential(){
+	string log = makeLog();
+	const uint8_t* data = (const uint8_t*)log.data();
+	INSDateTracker start;
+	start.setDate(2024, 12, 31);
+
+	NMEAParser parser;
+	INSService service(parser);
+	service.date = start;
+	Records sequential;
+	service.publishTo(sequential);
+	LogReplayStats expected = LogReplay(parser).replay(data, log.size());
+	CHECK(sequential.all.size() > 45000);
+	CHECK(expected.errors > 50);
+
+	// the records go over three dates, in time order but for the late ones
+	int64_t first = get<1>(sequential.all.front()), last = get<1>(sequential.all.back());
+	CHECK(first == (int64_t)(daysFromCivil(2024, 12, 31) * 86400 + 20 * 3600) * 1000000000LL);
+	CHECK(last / 86400000000000LL == daysFromCivil(2025, 1, 3));
+	size_t backwards = 0;
+	for (size_t i = 1; i < sequential.all.size(); i++){
+		if (get<1>(sequential.all[i]) < get<1>(sequential.all[i - 1]) - 30000000000LL
+			|| get<1>(sequential.all[i]) > get<1>(sequential.all[i - 1]) + 6 * 3600 * 1000000000LL){
+			backwards++;
+		}
+	}
+	CHECK(backwards == 0);
+
+	struct Run { size_t threads; size_t chunkSize; };
+	for (Run run : { Run{ 1, 1 << 20 }, Run{ 3, 4096 }, Run{ 4, 100000 }, Run{ 2, 777 }, Run{ 8, 1 } }){
+		ParallelLogReplay parallel;
+		parallel.threads = run.threads;
+		parallel.chunkSize = run.chunkSize;
+		parallel.date = start;
+		Records records;
+		parallel.onRecord += [&records](const INSRecord& record){ records.push(record); };
+		LogReplayStats stats = parallel.replay(data, log.size());
+
+		CHECK(records.all == sequential.all);
+		CHECK(stats.errors == expected.errors);
+		CHECK(stats.bytes == log.size());
+	}
+}
+
+int main(){
+	sameAsSequential();
+	return checkResult("test_parallel_replay");
+}
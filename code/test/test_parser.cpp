@@ -0,0 +1,247 @@
+/*
+ * test_parser.cpp
+ *
+ *  NMEAParser: the tokenizer edge cases on every path in, the prefilter and the non-throwing API.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/NMEAParser.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+static string withChecksum(const string& body){
+	char checksum[4];
+	snprintf(checksum, sizeof(checksum), "%02X", NMEAParser::calculateChecksum(body));
+	return "$" + body + "*" + checksum;
+}
+
+// What a line turned into
+struct Seen {
+	NMEAParseStatus status;
+	bool dispatched;
+	string name;
+	vector<string> parameters;
+	bool checksumIsCalculated;
+	bool checksumOK;
+
+	bool operator==(const Seen& s) const {
+		return status == s.status && dispatched == s.dispatched && name == s.name && parameters == s.parameters
+			&& checksumIsCalculated == s.checksumIsCalculated && checksumOK == s.checksumOK;
+	}
+};
+
+enum class Path { Sentence, Buffer, SplitBuffer, Bytes };
+
+// The line goes through readSentence, or with a newline through the byte stream: in one
+// buffer, in two (the sentence spans them) or byte by byte.
+static Seen read(const string& line, Path path){
+	NMEAParser parser;
+	Seen seen = { NMEAParseStatus::Ok, false, "", {}, false, false };
+	parser.onSentence += [&seen](const NMEASentence& n){
+		seen.dispatched = true;
+		seen.name = string(n.name);
+		seen.parameters.assign(n.parameters.begin(), n.parameters.end());
+		seen.checksumIsCalculated = n.checksumIsCalculated;
+		seen.checksumOK = n.checksumOK();
+	};
+
+	string text = line + "\r\n";
+	const uint8_t* b = (const uint8_t*)text.data();
+	uint32_t half = (uint32_t)text.size() / 2;
+	switch (path){
+	case Path::Sentence:
+		seen.status = parser.tryReadSentence(line).status;
+		break;
+	case Path::Buffer:
+		seen.status = parser.tryReadBuffer(b, (uint32_t)text.size()).status;
+		break;
+	case Path::SplitBuffer:
+		seen.status = parser.tryReadBuffer(b, half).status;
+		if (seen.status == NMEAParseStatus::Ok){
+			seen.status = parser.tryReadBuffer(b + half, (uint32_t)text.size() - half).status;
+		}
+		break;
+	case Path::Bytes:
+		for (uint8_t c : text){
+			NMEAParseResult result = parser.tryReadByte(c);
+			if (!result){
+				seen.status = result.status;
+			}
+		}
+		break;
+	}
+	return seen;
+}
+
+// Same results as the parser had before its single pass tokenizer
+static void tokenizer(){
+	struct Case {
+		string line;
+		Seen expected;
+	};
+	const NMEAParseStatus Ok = NMEAParseStatus::Ok, InvalidText = NMEAParseStatus::InvalidText;
+	const string cs = withChecksum("GPGGA,1,2").substr(10);		// "*" and the digits
+	const Case cases[] = {
+		{ "$GPGGA,1,2",				{ Ok, true, "GPGGA", { "1", "2" }, false, false } },
+		{ "$GPGGA,1,2,",			{ Ok, true, "GPGGA", { "1", "2", "" }, false, false } },	// trailing comma, no checksum
+		{ "$GPGGA,",				{ Ok, true, "GPGGA", { "" }, false, false } },
+		{ "$GPGGA",					{ Ok, true, "GPGGA", {}, false, false } },
+		{ "$,",						{ InvalidText, false, "", {}, false, false } },
+		{ "$,1,2",					{ InvalidText, false, "", {}, false, false } },
+		{ "$",						{ InvalidText, false, "", {}, false, false } },
+		{ "$GPGGA,1,2*",			{ NMEAParseStatus::EmptyChecksum, false, "", {}, false, false } },
+		{ "$GPGGA,1,2" + cs,		{ Ok, true, "GPGGA", { "1", "2" }, true, true } },
+		{ withChecksum("GPGGA,1,2,"),	{ Ok, true, "GPGGA", { "1", "2", "" }, true, true } },
+		{ withChecksum("GPGGA,1") + ",",	{ InvalidText, false, "", {}, false, false } },	// comma after the checksum
+		{ "$GPGGA,1,2*00",			{ Ok, true, "GPGGA", { "1", "2" }, true, false } },
+		{ "$GPGGA,1,2*ZZ",			{ NMEAParseStatus::UnreadableChecksum, false, "", {}, false, false } },
+		{ "x$GPRMC,3$GPGGA,1,2" + cs,	{ Ok, true, "GPGGA", { "1", "2" }, true, true } },		// from the last '$'
+		{ " $GP GGA, 1 ,2\t" + cs,	{ Ok, true, "GPGGA", { "1", "2" }, true, true } },		// whitespace is dropped
+		{ "$GP-GA,1",				{ InvalidText, false, "", {}, false, false } },
+		{ "$GPGGA,1#,2",			{ NMEAParseStatus::InvalidCharacter, false, "", {}, false, false } },
+	};
+
+	for (const Case& c : cases){
+		for (Path path : { Path::Sentence, Path::Buffer, Path::SplitBuffer, Path::Bytes }){
+			if (!(read(c.line, path) == c.expected)){
+				fprintf(stderr, "\"%s\", path %d\n", c.line.c_str(), (int)path);
+				CHECK(read(c.line, path) == c.expected);
+			}
+		}
+	}
+}
+
+// Sentences longer than the buffer are dropped the same way by readByte and readBuffer,
+// whatever the chunks, and the next one is read.
+static void overflow(){
+	const size_t limit = NMEA_PARSER_MAX_BUFFER_SIZE;		// bytes from the '$' to the newline
+	for (size_t size = limit - 3; size <= limit + 3; size++){
+		string text = "$GPLNG," + string(size - 8, '1') + "\r\n$GPGGA,1,2\r\n";
+
+		vector<vector<string>> byBytes;
+		{
+			NMEAParser parser;
+			parser.onSentence += [&byBytes](const NMEASentence& n){ byBytes.push_back({ string(n.name), to_string(n.parameters[0].size()) }); };
+			for (uint8_t c : text){
+				parser.readByte(c);
+			}
+		}
+		CHECK(byBytes.size() == (size <= limit ? 2 : 1));
+		CHECK(byBytes.back()[0] == "GPGGA");
+
+		for (size_t chunk : { text.size(), (size_t)1000, (size_t)7, (size_t)1 }){
+			vector<vector<string>> byBuffer;
+			NMEAParser parser;
+			parser.onSentence += [&byBuffer](const NMEASentence& n){ byBuffer.push_back({ string(n.name), to_string(n.parameters[0].size()) }); };
+			for (size_t i = 0; i < text.size(); i += chunk){
+				parser.readBuffer((const uint8_t*)text.data() + i, (uint32_t)min(chunk, text.size() - i));
+			}
+			CHECK(byBuffer == byBytes);
+		}
+	}
+}
+
+// Names of 9 characters sharing their first 8, hence their key: two have readers, two
+// are read by nobody. With the prefilter, sentences nobody reads are dropped and counted
+// by name, on every path.
+static void prefilter(){
+	vector<string> lines = {
+		"$GPGGA,1,2", "$PASHRABC2,1", "$GPGSV,1,2,3", withChecksum("PASHRABC1,1"), "$GPGSV,4,5",
+		"$GPGSV,6*00", "$GP#SV,1", "$PASHRABC3,1", "$GPRMC,1", withChecksum("GPGGA,1"),
+		"$PASHRABC2,2", "$GPGSV,7", "$PASHRABC4,1", "$PASHRABC2,3", "$PASHRABC1,2",
+	};
+	string text;
+	for (const string& line : lines){
+		text += line + "\r\n";
+	}
+
+	for (Path path : { Path::Sentence, Path::Buffer, Path::Bytes }){
+		NMEAParser parser;
+		parser.prefilter = true;
+		vector<string> read;
+		parser.setSentenceHandler("GPGGA", [&read](const NMEASentence& n){ read.push_back(string(n.name)); });
+		parser.setSentenceReader("PASHRABC1", [&read](const NMEASentence& n){
+			read.push_back(string(n.name) + " " + string(n.parameters[0]));
+			return NMEAParseResult();
+		});
+		parser.setSentenceHandler("PASHRABC3", [&read](const NMEASentence& n){ read.push_back(string(n.name)); });
+
+		size_t errors = 0;
+		if (path == Path::Sentence){
+			for (const string& line : lines){
+				errors += !parser.tryReadSentence(line);
+			}
+		}
+		else if (path == Path::Buffer){
+			const uint8_t* b = (const uint8_t*)text.data();
+			uint32_t left = (uint32_t)text.size(), consumed;
+			while (left > 0 && !parser.tryReadBuffer(b, left, consumed)){
+				errors++;
+				b += consumed;
+				left -= consumed;
+			}
+		}
+		else{
+			for (uint8_t c : text){
+				errors += !parser.tryReadByte(c);
+			}
+		}
+
+		CHECK(errors == 1);		// the name with a '#' is parsed, not dropped
+		CHECK((read == vector<string>{ "GPGGA", "PASHRABC1 1", "PASHRABC3", "GPGGA", "PASHRABC1 2" }));
+		CHECK(parser.droppedSentenceCount("GPGSV") == 4 && parser.droppedSentenceCount("PASHRABC2") == 3);
+		CHECK(parser.droppedSentenceCount("PASHRABC1") == 0 && parser.droppedSentenceCount("GP#SV") == 0);
+		CHECK((parser.getDroppedSentenceCounts() == vector<pair<string, uint64_t>>{ { "GPGSV", 4 }, { "GPRMC", 1 }, { "PASHRABC2", 3 }, { "PASHRABC4", 1 } }));
+
+		// nothing is dropped while onSentence sees every sentence
+		parser.clearDroppedSentenceCounts();
+		size_t seen = 0;
+		parser.onSentence += [&seen](const NMEASentence&){ seen++; };
+		parser.tryReadSentence("$GPGSV,1");
+		parser.tryReadBuffer((const uint8_t*)"$GPRMC,1\r\n", 10);
+		CHECK(seen == 2 && parser.getDroppedSentenceCounts().empty());
+	}
+}
+
+static NMEAParseResult readBuffer(NMEAParser& parser, const string& text, uint32_t& consumed){
+	return parser.tryReadBuffer((const uint8_t*)text.data(), (uint32_t)text.size(), consumed);
+}
+
+static void tryReadBuffer(){
+	// the offset is where in the sentence the problem is, consumed how far in the buffer
+	NMEAParser parser;
+	string first = "$GPGGA,1,2*75\r\n", bad = "$TEST,ab#c,d\r\n", last = "$T,*\r\n";
+	string text = first + bad + last;
+	uint32_t consumed = 0;
+
+	NMEAParseResult result = readBuffer(parser, text, consumed);
+	CHECK(result.status == NMEAParseStatus::InvalidCharacter);
+	CHECK(result.offset == 8);
+	CHECK(consumed == first.size() + bad.size());
+	CHECK(parser.tryReadSentence(bad).offset == result.offset);
+
+	result = readBuffer(parser, text.substr(consumed), consumed);
+	CHECK(result.status == NMEAParseStatus::EmptyChecksum && result.offset == 3);
+	CHECK(consumed == last.size());
+
+	result = readBuffer(parser, first + first, consumed);
+	CHECK(result.ok() && consumed == 2 * first.size());
+
+	result = parser.tryReadBuffer((const uint8_t*)bad.data(), (uint32_t)bad.size());
+	CHECK(result.status == NMEAParseStatus::InvalidCharacter && result.offset == 8);
+}
+
+int main(){
+	tokenizer();
+	overflow();
+	prefilter();
+	tryReadBuffer();
+	return checkResult("test_parser");
+}
@@ -0,0 +1,363 @@
+/*
+ * test_record_log.cpp
+ *
+ *  INSRecordLogWriter and INSRecordLogReader.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSRecordLog.h>
+#include <nmeaparse/INSTimeIndex.h>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <unistd.h>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static INSTimestamp::TimePoint at(int64_t ms){
+	return INSTimestamp::TimePoint(milliseconds(1735689600000LL + ms));
+}
+
+static INSRecord techsas(INSTimestamp::TimePoint time, double heading){
+	TECHSASRecord r = TECHSASRecord();
+	r.time = time;
+	r.heading = heading;
+	return INSRecord(r);
+}
+
+static bool writeLog(const string& path, const vector<INSRecord>& records, size_t blockSize){
+	INSRecordLogWriter writer;
+	writer.blockSize = blockSize;
+	if (!writer.open(path)){
+		return false;
+	}
+	for (const INSRecord& r : records){
+		writer.push(r);
+	}
+	return writer.close();
+}
+
+// one of each type in turn, every field set
+static vector<INSRecord> mixedRecords(size_t count){
+	mt19937 random(6);
+	auto value = [&random]{ return (double)(int32_t)random() / 1000.0; };
+	vector<INSRecord> records;
+	for (size_t i = 0; i < count; i++){
+		INSTimestamp::TimePoint time = at((int64_t)i * 40);
+		switch (i % 4){
+		case 0:{
+			AIPOVRecord r = AIPOVRecord();
+			r.time = time;
+			double* fields = &r.heading;
+			for (int k = 0; k < 19; k++){
+				fields[k] = value();
+			}
+			r.user_status.bits = random();
+			records.push_back(INSRecord(r));
+			break;
+		}
+		case 1:{
+			TECHSASRecord r = TECHSASRecord();
+			r.time = time;
+			double* fields = &r.heading;
+			for (int k = 0; k < 7; k++){
+				fields[k] = value();
+			}
+			r.true_heading = random() & 1;
+			r.x = random() & 1;
+			r.y = random() & 1;
+			records.push_back(INSRecord(r));
+			break;
+		}
+		case 2:{
+			IXSEA_TAHRecord r = IXSEA_TAHRecord();
+			r.time = time;
+			r.protocol_version_id = random() % 100;
+			r.latency = random() % 1000;
+			r.utc_time_status = (INSStatus)(random() % 4);
+			r.heave_status = (INSStatus)(random() % 4);
+			double* fields = &r.true_heading;
+			for (int k = 0; k < 11; k++){
+				fields[k] = value();
+			}
+			records.push_back(INSRecord(r));
+			break;
+		}
+		default:{
+			ZDARecord r;
+			r.time = time;
+			records.push_back(INSRecord(r));
+			break;
+		}
+		}
+	}
+	return records;
+}
+
+static bool sameDoubles(const double* a, const double* b, int count){
+	return memcmp(a, b, count * sizeof(double)) == 0;
+}
+
+static bool sameRecord(const INSRecord& a, const INSRecord& b){
+	if (a.type != b.type || a.time() != b.time()){
+		return false;
+	}
+	switch (a.type){
+	case INSRecordType::AIPOV:
+		return sameDoubles(&a.aipov.heading, &b.aipov.heading, 19) && a.aipov.user_status.bits == b.aipov.user_status.bits;
+	case INSRecordType::TECHSAS:
+		return sameDoubles(&a.techsas.heading, &b.techsas.heading, 7) && a.techsas.true_heading == b.techsas.true_heading
+			&& a.techsas.x == b.techsas.x && a.techsas.y == b.techsas.y;
+	case INSRecordType::IXSEA_TAH:
+		return sameDoubles(&a.ixsea_tah.true_heading, &b.ixsea_tah.true_heading, 11)
+			&& a.ixsea_tah.protocol_version_id == b.ixsea_tah.protocol_version_id && a.ixsea_tah.latency == b.ixsea_tah.latency
+			&& a.ixsea_tah.utc_time_status == b.ixsea_tah.utc_time_status && a.ixsea_tah.heave_status == b.ixsea_tah.heave_status;
+	default:
+		return true;
+	}
+}
+
+static vector<INSRecord> readLog(const string& path, uint64_t& badBlocks){
+	vector<INSRecord> records;
+	INSRecordLogReader reader;
+	if (reader.open(path)){
+		INSRecord r;
+		while (reader.next(r)){
+			records.push_back(r);
+		}
+	}
+	badBlocks = reader.badBlocks();
+	return records;
+}
+
+static void flipByte(const string& path, uint64_t offset){
+	FILE* f = fopen(path.c_str(), "r+b");
+	fseek(f, (long)offset, SEEK_SET);
+	int c = fgetc(f);
+	fseek(f, (long)offset, SEEK_SET);
+	fputc(c ^ 0x10, f);
+	fclose(f);
+}
+
+static void roundTrip(){
+	vector<INSRecord> records = mixedRecords(5000);
+	string path = tempPath("roundtrip.inslog");
+	CHECK(writeLog(path, records, 4096));
+
+	uint64_t bad;
+	vector<INSRecord> read = readLog(path, bad);
+	CHECK(bad == 0);
+	CHECK(read.size() == records.size());
+	bool same = read.size() == records.size();
+	for (size_t i = 0; same && i < read.size(); i++){
+		same = sameRecord(read[i], records[i]);
+	}
+	CHECK(same);
+
+	INSRecordLogReader reader;
+	CHECK(reader.open(path));
+	CHECK(reader.version() == INSRecordLogFormat::Version);
+	vector<INSRecord> bulk(records.size() + 10);
+	CHECK(reader.read(bulk.data(), bulk.size()) == records.size());
+	remove(path.c_str());
+}
+
+static void corruptedBlock(){
+	vector<INSRecord> records = mixedRecords(5000);
+	string path = tempPath("corrupt.inslog");
+	CHECK(writeLog(path, records, 4096));
+
+	// the blocks and the records in each
+	vector<INSRecordLogReader::Block> blocks;
+	{
+		INSRecordLogReader reader;
+		CHECK(reader.open(path));
+		INSRecordLogReader::Block block;
+		while (reader.nextBlock(block)){
+			blocks.push_back(block);
+		}
+	}
+	CHECK(blocks.size() > 10);
+	size_t damaged = blocks.size() / 2;
+	size_t before = 0;
+	for (size_t i = 0; i < damaged; i++){
+		before += blocks[i].count;
+	}
+
+	// a byte in the middle of its payload, then one in the header of the next
+	flipByte(path, blocks[damaged].offset + INSRecordLogFormat::BlockHeaderSize + blocks[damaged].size / 2);
+	uint64_t bad;
+	vector<INSRecord> read = readLog(path, bad);
+	CHECK(bad == 1);
+	CHECK(read.size() == records.size() - blocks[damaged].count);
+	bool same = read.size() == records.size() - blocks[damaged].count;
+	for (size_t i = 0; same && i < read.size(); i++){
+		size_t original = (i < before) ? i : i + blocks[damaged].count;
+		same = sameRecord(read[i], records[original]);
+	}
+	CHECK(same);
+
+	flipByte(path, blocks[damaged + 1].offset + 12);
+	read = readLog(path, bad);
+	CHECK(bad == 1);		// next to each other, one damaged stretch
+	CHECK(read.size() == records.size() - blocks[damaged].count - blocks[damaged + 1].count);
+
+	flipByte(path, blocks[damaged + 4].offset + 20);
+	read = readLog(path, bad);
+	CHECK(bad == 2);
+	remove(path.c_str());
+}
+
+static void tornTailAndAppend(){
+	vector<INSRecord> records = mixedRecords(3000);
+	string path = tempPath("torn.inslog");
+	INSRecordLogWriter writer;
+	writer.blockSize = 4096;
+	CHECK(writer.open(path));
+	for (const INSRecord& r : records){
+		writer.push(r);
+	}
+	CHECK(writer.close());
+	uint64_t size = writer.bytesWritten();
+
+	// a crash in the middle of the last block
+	CHECK(truncate(path.c_str(), (off_t)(size - 100)) == 0);
+	uint64_t bad;
+	vector<INSRecord> read = readLog(path, bad);
+	CHECK(read.size() < records.size() && read.size() > records.size() - 4096 / 9);
+	bool same = true;
+	for (size_t i = 0; i < read.size(); i++){
+		same = same && sameRecord(read[i], records[i]);
+	}
+	CHECK(same);
+
+	// appending cuts the torn block and goes on after the good ones
+	size_t kept = read.size();
+	CHECK(writer.open(path, true));
+	for (size_t i = 0; i < 10; i++){
+		writer.push(records[i]);
+	}
+	CHECK(writer.close());
+	read = readLog(path, bad);
+	CHECK(bad == 0);
+	CHECK(read.size() == kept + 10);
+	CHECK(read.size() == kept + 10 && sameRecord(read.back(), records[9]));
+
+	// not a log
+	FILE* f = fopen(path.c_str(), "wb");
+	fputs("$AIPOV,not a log\r\n", f);
+	fclose(f);
+	INSRecordLogReader reader;
+	CHECK(!reader.open(path));
+	CHECK(!writer.open(path, true));
+	remove(path.c_str());
+}
+
+static void seekPastLateRecords(){
+	// every 7th record is late, 20 s behind the others
+	vector<INSRecord> records;
+	for (int i = 0; i < 400; i++){
+		records.push_back(techsas(at(i % 7 == 6 ? i * 100 - 20000 : i * 100), i));
+	}
+	string path = tempPath("seek.inslog");
+	CHECK(writeLog(path, records, 4 * INSRecordLogFormat::recordSize(INSRecordType::TECHSAS)));
+
+	INSRecordLogReader reader;
+	CHECK(reader.open(path));
+	for (int64_t t = -30000; t <= 41000; t += 50){
+		// first record in file order at or after t
+		size_t expected = 0;
+		while (expected < records.size() && records[expected].time() < at(t)){
+			expected++;
+		}
+		INSRecord record;
+		bool found = reader.seek(at(t));
+		CHECK(found == (expected < records.size()));
+		if (found){
+			CHECK(reader.next(record) && record.techsas.heading == records[expected].techsas.heading);
+		}
+	}
+	CHECK(reader.badBlocks() == 0);
+	remove(path.c_str());
+}
+
+// index of first record in file order at or after time, or records.size()
+static size_t firstAtOrAfter(const vector<INSRecord>& records, INSTimestamp::TimePoint time){
+	size_t i = 0;
+	while (i < records.size() && records[i].time() < time){
+		i++;
+	}
+	return i;
+}
+
+static void checkSeeks(INSRecordLogReader& reader, const vector<INSRecord>& records, const INSTimeIndex& index){
+	for (int64_t t = -1000; t <= 45000; t += 70){
+		size_t expected = firstAtOrAfter(records, at(t));
+		INSRecord record;
+		bool found = reader.seek(at(t), index);
+		CHECK(found == (expected < records.size()));
+		if (found){
+			CHECK(reader.next(record) && record.techsas.heading == records[expected].techsas.heading);
+		}
+	}
+}
+
+static void seekWithIndex(){
+	const size_t recordSize = INSRecordLogFormat::recordSize(INSRecordType::TECHSAS);
+	string path = tempPath("index.inslog");
+
+	vector<INSRecord> before;
+	for (int i = 0; i < 400; i++){
+		before.push_back(techsas(at(i * 100), i));
+	}
+	CHECK(writeLog(path, before, 4 * recordSize));
+	INSTimeIndex index;
+	CHECK(index.buildFromRecordLog(path, seconds(1)));
+	CHECK(index.getEntries().size() > 30);
+
+	INSRecordLogReader reader;
+	CHECK(reader.open(path));
+	checkSeeks(reader, before, index);
+
+	// saved next to the log and loaded for it, not for another kind or size of log
+	string indexPath = INSTimeIndex::sidecarPath(path);
+	INSTimeIndex loaded;
+	CHECK(index.save(indexPath));
+	CHECK(!loaded.load(indexPath, INSTimeIndex::Source::Text, reader.size()));
+	CHECK(!loaded.load(indexPath, INSTimeIndex::Source::RecordLog, reader.size() + 1));
+	CHECK(loaded.load(indexPath, INSTimeIndex::Source::RecordLog, reader.size()));
+	checkSeeks(reader, before, loaded);
+	reader.close();
+
+	// the log is rewritten with other blocks and more records, the index is stale
+	vector<INSRecord> after;
+	for (int i = 0; i < 450; i++){
+		after.push_back(techsas(at(i * 90 + 30), 1000 + i));
+	}
+	CHECK(writeLog(path, after, 5 * recordSize));
+	CHECK(reader.open(path));
+	checkSeeks(reader, after, index);
+	CHECK(reader.badBlocks() == 0);
+	CHECK(!loaded.load(indexPath, INSTimeIndex::Source::RecordLog, reader.size()));
+
+	CHECK(index.buildFromRecordLog(path, seconds(1)));
+	checkSeeks(reader, after, index);
+	CHECK(reader.badBlocks() == 0);
+	remove(path.c_str());
+	remove(indexPath.c_str());
+}
+
+int main(){
+	roundTrip();
+	corruptedBlock();
+	tornTailAndAppend();
+	seekPastLateRecords();
+	seekWithIndex();
+	return checkResult("test_record_log");
+}
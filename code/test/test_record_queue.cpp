@@ -0,0 +1,167 @@
+/*
+ * test_record_queue.cpp
+ *
+ *  SPSCQueue and MPMCQueue under load: nothing lost, nothing twice, FIFO per producer,
+ *  and what the overflow policies drop is counted.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/RecordQueue.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+struct Value {
+	uint32_t producer;
+	uint32_t sequence;
+	uint64_t check;		// from the two above, a torn value would not match
+
+	static Value make(uint32_t p, uint32_t s){
+		return Value{ p, s, ((uint64_t)p << 32 | s) * 0x9E3779B97F4A7C15ULL };
+	}
+	bool intact() const {
+		return check == ((uint64_t)producer << 32 | sequence) * 0x9E3779B97F4A7C15ULL;
+	}
+};
+
+static void spsc(){
+	const uint32_t count = 1000000;
+	SPSCQueue<Value> queue(64, OverflowPolicy::Block);
+
+	thread producer([&]{
+		for (uint32_t i = 0; i < count; i++){
+			queue.push(Value::make(0, i));
+		}
+	});
+
+	uint32_t expected = 0;
+	bool inOrder = true, intact = true;
+	Value v;
+	while (expected < count){
+		if (queue.pop(v)){
+			inOrder = inOrder && v.sequence == expected;
+			intact = intact && v.intact();
+			expected++;
+		}
+		else{
+			this_thread::yield();
+		}
+	}
+	producer.join();
+	CHECK(inOrder);
+	CHECK(intact);
+	CHECK(!queue.pop(v));
+	CHECK(queue.lostCount() == 0);
+}
+
+static void mpmc(){
+	const uint32_t producers = 4, consumers = 4, count = 200000;
+	MPMCQueue<Value> queue(128, OverflowPolicy::Block);
+
+	vector<thread> threads;
+	for (uint32_t p = 0; p < producers; p++){
+		threads.emplace_back([&queue, p, count]{
+			for (uint32_t i = 0; i < count; i++){
+				queue.push(Value::make(p, i));
+			}
+		});
+	}
+
+	// each consumer sees the values of a producer in the order they were pushed
+	atomic<uint64_t> popped(0);
+	vector<vector<uint8_t>> seen(producers, vector<uint8_t>(count, 0));
+	atomic<bool> ordered(true), intact(true);
+	for (uint32_t c = 0; c < consumers; c++){
+		threads.emplace_back([&]{
+			vector<int64_t> last(producers, -1);
+			Value v;
+			while (popped.load() < (uint64_t)producers * count){
+				if (!queue.pop(v)){
+					this_thread::yield();
+					continue;
+				}
+				popped.fetch_add(1);
+				if (!v.intact() || v.producer >= producers || v.sequence >= count){
+					intact = false;
+					continue;
+				}
+				if ((int64_t)v.sequence <= last[v.producer]){
+					ordered = false;
+				}
+				last[v.producer] = v.sequence;
+				seen[v.producer][v.sequence]++;		// each slot written by one consumer only
+			}
+		});
+	}
+	for (thread& t : threads){
+		t.join();
+	}
+
+	CHECK(intact.load());
+	CHECK(ordered.load());
+	bool once = true;
+	for (uint32_t p = 0; p < producers; p++){
+		for (uint32_t i = 0; i < count; i++){
+			once = once && seen[p][i] == 1;
+		}
+	}
+	CHECK(once);
+	CHECK(popped.load() == (uint64_t)producers * count);
+}
+
+static void overflow(OverflowPolicy policy){
+	const uint32_t count = 200000;
+	SPSCQueue<Value> queue(16, policy);
+	atomic<bool> done(false);
+
+	thread producer([&]{
+		for (uint32_t i = 0; i < count; i++){
+			queue.push(Value::make(0, i));
+		}
+		done = true;
+	});
+
+	// slow consumer, what it gets is still in order
+	uint64_t received = 0;
+	int64_t last = -1;
+	bool inOrder = true, intact = true;
+	Value v;
+	while (true){
+		bool finished = done.load();
+		if (queue.pop(v)){
+			inOrder = inOrder && (int64_t)v.sequence > last;
+			intact = intact && v.intact();
+			last = v.sequence;
+			received++;
+			if (received % 64 == 0){
+				this_thread::yield();
+			}
+		}
+		else if (finished){
+			break;
+		}
+		else{
+			this_thread::yield();
+		}
+	}
+	producer.join();
+
+	CHECK(inOrder);
+	CHECK(intact);
+	CHECK(received + queue.lostCount() == count);
+	CHECK(last == (int64_t)count - 1 || policy == OverflowPolicy::DropNewest);
+}
+
+int main(){
+	spsc();
+	mpmc();
+	overflow(OverflowPolicy::DropNewest);
+	overflow(OverflowPolicy::OverwriteOldest);
+	return checkResult("test_record_queue");
+}
@@ -0,0 +1,94 @@
+/*
+ * test_seqlock.cpp
+ *
+ *  SeqLock: readers racing a writer only ever see whole values, newer and newer.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/SeqLock.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace nmea;
+
+
+// larger than a cache line, so a store is several words apart
+struct Pose {
+	uint64_t sequence;
+	double values[14];
+	uint64_t sequenceAgain;
+
+	static Pose make(uint64_t s){
+		Pose p;
+		p.sequence = s;
+		for (int i = 0; i < 14; i++){
+			p.values[i] = (double)s * (i + 1);
+		}
+		p.sequenceAgain = s;
+		return p;
+	}
+	bool intact() const {
+		if (sequence != sequenceAgain){
+			return false;
+		}
+		for (int i = 0; i < 14; i++){
+			if (values[i] != (double)sequence * (i + 1)){
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+int main(){
+	const uint64_t stores = 300000;
+	SeqLock<Pose> latest(Pose::make(0));
+	atomic<bool> done(false);
+
+	vector<thread> readers;
+	atomic<bool> intact(true), forward(true);
+	atomic<uint64_t> reads(0);
+	for (int r = 0; r < 3; r++){
+		readers.emplace_back([&]{
+			uint64_t last = 0;
+			while (!done.load()){
+				Pose p = latest.load();
+				if (!p.intact()){
+					intact = false;
+				}
+				if (p.sequence < last){
+					forward = false;
+				}
+				last = p.sequence;
+				reads.fetch_add(1, memory_order_relaxed);
+				this_thread::yield();
+			}
+		});
+	}
+
+	uint64_t version = latest.version();
+	for (uint64_t s = 1; s <= stores; s++){
+		latest.store(Pose::make(s));
+		if ((s & 255) == 0){
+			this_thread::yield();
+		}
+	}
+	done = true;
+	for (thread& t : readers){
+		t.join();
+	}
+
+	CHECK(intact.load());
+	CHECK(forward.load());
+	CHECK(reads.load() > 0);
+	CHECK(latest.load().sequence == stores);
+	CHECK(latest.version() == version + stores);
+
+	Pose p;
+	CHECK(latest.tryLoad(p) && p.sequence == stores);
+	return checkResult("test_seqlock");
+}
@@ -0,0 +1,173 @@
+/*
+ * test_time_index.cpp
+ *
+ *  INSTimeIndex over a text log, and LogReplay::replay of a window with it: the same
+ *  records, with the same dates, as a replay of the whole log.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSTimeIndex.h>
+#include <nmeaparse/LogReplay.h>
+#include <nmeaparse/INSService.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+typedef INSTimestamp::TimePoint TimePoint;
+
+static string sentence(const string& body){
+	char checksum[8];
+	snprintf(checksum, sizeof(checksum), "*%02X\r\n", NMEAParser::calculateChecksum(body));
+	return "$" + body + checksum;
+}
+
+// PASHR every 40 ms from 23:50 on Dec 31 2024 over midnight, with a few late ones
+// and a few ZDA
+static string makeLog(){
+	mt19937 random(7);
+	string log;
+	int64_t ms = (23 * 3600 + 50 * 60) * 1000LL;
+	for (int i = 0; i < 60000; i++, ms += 40){
+		int64_t t = ms;
+		if (random() % 100 == 0){
+			t -= 30000;
+		}
+		int64_t day = t / 86400000, tod = t % 86400000;
+		char time[32];
+		snprintf(time, sizeof(time), "%02d%02d%02d.%03d", (int)(tod / 3600000), (int)(tod / 60000 % 60), (int)(tod / 1000 % 60), (int)(tod % 1000));
+
+		char body[128];
+		snprintf(body, sizeof(body), "PASHR,%s,%d.00,T,1.2,-3.4,0.5,0.1,0.1,0.2,1,0", time, i % 360);
+		log += sentence(body);
+		if (i % 5000 == 0){
+			snprintf(body, sizeof(body), "GPZDA,%s,%02d,%02d,%d,00,00", time, day ? 1 : 31, day ? 1 : 12, day ? 2025 : 2024);
+			log += sentence(body);
+		}
+	}
+	return log;
+}
+
+struct Records {
+	vector<INSRecord> all;
+	void push(const INSRecord& record){
+		if (record.type == INSRecordType::TECHSAS){
+			all.push_back(record);
+		}
+	}
+	vector<pair<int64_t, double>> window(TimePoint from, TimePoint to) const {
+		vector<pair<int64_t, double>> w;
+		for (const INSRecord& r : all){
+			if (r.time() >= from && r.time() <= to){
+				w.push_back({ r.time().time_since_epoch().count(), r.techsas.heading });
+			}
+		}
+		return w;
+	}
+};
+
+static Records replayAll(const MappedFile& file, const INSDateTracker& start){
+	NMEAParser parser;
+	INSService service(parser);
+	service.date = start;
+	Records records;
+	service.publishTo(records);
+	LogReplay(parser).replay(file);
+	return records;
+}
+
+static void windows(){
+	string path = tempPath("window.log");
+	FILE* f = fopen(path.c_str(), "wb");
+	string log = makeLog();
+	fwrite(log.data(), 1, log.size(), f);
+	fclose(f);
+
+	MappedFile file;
+	CHECK(file.open(path));
+	INSDateTracker start;
+	start.setDate(2024, 12, 31);
+	Records full = replayAll(file, start);
+	CHECK(full.all.size() == 60000);
+
+	INSTimeIndex index;
+	index.buildFromText(file, seconds(10), start);
+	CHECK(index.getEntries().size() > 200);
+	CHECK(index.sourceType() == INSTimeIndex::Source::Text && index.sourceSize() == file.size());
+
+	// and the same once saved and loaded
+	string indexPath = INSTimeIndex::sidecarPath(path);
+	CHECK(index.save(indexPath));
+	INSTimeIndex loaded;
+	CHECK(loaded.load(indexPath, INSTimeIndex::Source::Text, file.size()));
+	CHECK(loaded.getEntries().size() == index.getEntries().size() && loaded.stride() == index.stride());
+
+	TimePoint first = full.all.front().time();
+	TimePoint last = first + milliseconds(40 * 60000);
+	bool same = true, shorter = true;
+	for (int k = -1; k <= 40; k++){
+		TimePoint from = first + (last - first) * k / 40;
+		TimePoint to = from + seconds(45);
+
+		NMEAParser parser;
+		INSService service(parser);
+		service.date.setDate(2020, 1, 1);		// whatever it was, the window sets it
+		if (k < 1){
+			service.date = start;		// no entry before, the start date is still needed
+		}
+		Records records;
+		service.publishTo(records);
+		LogReplayStats stats = LogReplay(parser).replay(file, loaded, from, to, service.date);
+
+		same = same && records.window(from, to) == full.window(from, to);
+		shorter = shorter && (k < 1 || stats.bytes < file.size() / 10);
+	}
+	CHECK(same);
+	CHECK(shorter);
+
+	// the index of another log is not used
+	INSTimeIndex other;
+	f = fopen(path.c_str(), "ab");
+	fputs(sentence("PASHR,001500.000,1.00,T,1.2,-3.4,0.5,0.1,0.1,0.2,1,0").c_str(), f);
+	fclose(f);
+	MappedFile longer;
+	CHECK(longer.open(path));
+	CHECK(!other.load(indexPath, INSTimeIndex::Source::Text, longer.size()));
+	CHECK(!other.load(indexPath, INSTimeIndex::Source::RecordLog, file.size()));
+	CHECK(other.getEntries().empty() && other.sourceType() == INSTimeIndex::Source::None);
+	CHECK(other.load(indexPath) && other.sourceSize() == file.size());
+	{
+		NMEAParser parser;
+		INSService service(parser);
+		service.date = start;
+		Records records;
+		service.publishTo(records);
+		LogReplayStats stats = LogReplay(parser).replay(longer, loaded, first + minutes(20), first + minutes(21), service.date);
+		CHECK(stats.bytes == longer.size());
+		CHECK(records.window(first + minutes(20), first + minutes(21)) == full.window(first + minutes(20), first + minutes(21)));
+	}
+
+	// a damaged index file is refused
+	f = fopen(indexPath.c_str(), "r+b");
+	fseek(f, 60, SEEK_SET);
+	fputc(0x5A, f);
+	fclose(f);
+	CHECK(!other.load(indexPath));
+	CHECK(!other.load(indexPath, INSTimeIndex::Source::Text, file.size()));
+	CHECK(!other.load(tempPath("missing.idx")));
+
+	remove(path.c_str());
+	remove(indexPath.c_str());
+}
+
+int main(){
+	windows();
+	return checkResult("test_time_index");
+}
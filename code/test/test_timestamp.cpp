@@ -0,0 +1,99 @@
+/*
+ * test_timestamp.cpp
+ *
+ *  INSTimestamp: the calendar arithmetic against timegm, and the time of day decoded
+ *  from the field text.
+ *
+ *  See the license file included with this source.
+ */
+
+#include <nmeaparse/INSFix.h>
+#include <ctime>
+#include <random>
+#include "check.h"
+
+using namespace std;
+using namespace std::chrono;
+using namespace nmea;
+
+
+static void calendar(){
+	// every day from 1900 to 2199
+	bool same = true, back = true;
+	for (int32_t year = 1900; year < 2200; year++){
+		for (int32_t month = 1; month <= 12; month++){
+			for (int32_t day = 1; day <= 31; day++){
+				struct tm t = {};
+				t.tm_year = year - 1900;
+				t.tm_mon = month - 1;
+				t.tm_mday = day;
+				time_t seconds = timegm(&t);
+				if (t.tm_mday != day){
+					continue;		// no such day, timegm moved to the next month
+				}
+				int64_t days = daysFromCivil(year, month, day);
+				same = same && days * 86400 == (int64_t)seconds;
+
+				int32_t y, m, d;
+				civilFromDays(days, y, m, d);
+				back = back && y == year && m == month && d == day;
+			}
+		}
+	}
+	CHECK(same);
+	CHECK(back);
+	CHECK(daysFromCivil(1970, 1, 1) == 0);
+	CHECK(daysFromCivil(2000, 3, 1) == 11017);
+}
+
+static void epoch(){
+	mt19937 random(3);
+	bool same = true;
+	for (int i = 0; i < 100000; i++){
+		INSTimestamp ts;
+		ts.year = 1970 + random() % 200;
+		ts.month = 1 + random() % 12;
+		ts.day = 1 + random() % 28;
+		ts.hour = random() % 24;
+		ts.min = random() % 60;
+		ts.sec = random() % 60;
+		ts.microsec = 0;
+		ts.nanosec = 0;
+
+		struct tm t = {};
+		t.tm_year = ts.year - 1900;
+		t.tm_mon = ts.month - 1;
+		t.tm_mday = ts.day;
+		t.tm_hour = ts.hour;
+		t.tm_min = ts.min;
+		t.tm_sec = ts.sec;
+		same = same && ts.getTime() == timegm(&t)
+			&& ts.timePoint().time_since_epoch() == seconds(timegm(&t));
+	}
+	CHECK(same);
+}
+
+static void timeOfDay(){
+	INSTimestamp ts;
+	CHECK(ts.setTime(string_view("235959.123456789")));
+	CHECK(ts.hour == 23 && ts.min == 59 && ts.sec == 59);
+	CHECK(ts.nanosec == 123456789 && ts.microsec == 123457);
+	CHECK(ts.timeOfDay() == hours(23) + minutes(59) + seconds(59) + nanoseconds(123456789));
+
+	CHECK(ts.setTime(string_view("000000")));
+	CHECK(ts.timeOfDay() == nanoseconds(0));
+	CHECK(ts.setTime(string_view("120000.5")));
+	CHECK(ts.timeOfDay() == hours(12) + milliseconds(500));
+
+	// not a plain time, nothing changes
+	CHECK(!ts.setTime(string_view("12x000.5")));
+	CHECK(!ts.setTime(string_view("")));
+	CHECK(ts.timeOfDay() == hours(12) + milliseconds(500));
+}
+
+int main(){
+	calendar();
+	epoch();
+	timeOfDay();
+	return checkResult("test_timestamp");
+}